@@ -2,6 +2,8 @@
 
 import os, sys
 import argparse
+import glob
+import struct
 
 import numpy as np
 import ROOT as rt
@@ -9,9 +11,40 @@ import pandas as pd
 
 from physlibs.root import root_style_ftm
 
+def readColumns(directory, tree):
+    ''' Columns of a tree written with --columns, as arrays mapped from the files;
+    the files of the worker threads are concatenated, which copies them '''
+    parts = dict()
+    for path in sorted(glob.glob(os.path.join(directory, tree+'.*.col'))):
+        with open(path, 'rb') as columnFile: header = columnFile.read(64)
+        if header[:8]!=b'GEMCOLS1': raise ValueError('%s is not a column file'%path)
+        headerSize, valueSize, rows = struct.unpack('<IIQ', header[8:24])
+        name = header[24:56].rstrip(b'\0').decode()
+        if os.path.getsize(path)>headerSize: values = np.memmap(path, dtype='<f8', mode='r', offset=headerSize)
+        else: values = np.empty(0)
+        # no count if the run did not finish, all complete values are kept
+        if rows>0: values = values[:rows]
+        parts.setdefault(name, list()).append(values)
+    return {name:(values[0] if len(values)==1 else np.concatenate(values)) for name,values in parts.items()}
+
+def readTree(options, rootFile, tree):
+    ''' Columns of a tree from the column files if given, else from the ROOT file '''
+    if options.columns: return readColumns(options.columns, tree)
+    if rootFile.Get(tree).GetEntries()==0: return {'energy': np.empty(0)}
+    treeData, treeColumns = rootFile.Get(tree).AsMatrix(return_labels=True)
+    return pd.DataFrame(data=treeData, columns=treeColumns)
+
+def fillHistogram(histogram, values, weights=None):
+    ''' Fills from arrays in one call instead of a Python loop '''
+    values = np.ascontiguousarray(values, dtype=np.float64)
+    if weights is None: weights = np.ones(len(values))
+    weights = np.ascontiguousarray(weights, dtype=np.float64)
+    if len(values)>0: histogram.FillN(len(values), values, weights)
+
 def main():
     ap = argparse.ArgumentParser(add_help=True)
     ap.add_argument('-i', '--input')
+    ap.add_argument('--columns', help='directory of column files written with --columns, read instead of the ROOT file')
     ap.add_argument('-o', '--output')
     ap.add_argument('--energies', nargs='+', type=float)
     ap.add_argument('--primaries', nargs='+', type=float)
@@ -39,15 +72,16 @@ def main():
     try: os.makedirs(options.output)
     except FileExistsError: pass
 
-    rootFile = rt.TFile(options.input)
+    rootFile = None if options.columns else rt.TFile(options.input)
 
 
     ''' Number of primaries '''
-    gasConversionData, gasConversionColumns = rootFile.Get('conversion').AsMatrix(return_labels=True)
-    gasConversionDataFrame = pd.DataFrame(data=gasConversionData, columns=gasConversionColumns)
+    gasConversionDataFrame = readTree(options, rootFile, 'conversion')
 
     primariesSpectrum = rt.TH1F('GasPrimaries', ';Primary electrons;', primariesBins, primariesBot, primariesTop)
-    for energy in gasConversionDataFrame['primaries']: primariesSpectrum.Fill(energy)
+    # weights differ from one with --forced-conversion
+    if 'weight' not in gasConversionDataFrame: gasConversionDataFrame['weight'] = np.ones(len(gasConversionDataFrame['primaries']))
+    fillHistogram(primariesSpectrum, gasConversionDataFrame['primaries'], gasConversionDataFrame['weight'])
     primariesSpectrum.Scale(1/primariesSpectrum.Integral(), 'width')
 
 
@@ -134,17 +168,14 @@ def main():
     legend = rt.TLegend(0.65, 0.6, 0.92, 0.92)
     legend.SetHeader('#bf{Position in detector}')
     for i,volume in enumerate(volumes):
-        volumeTree = rootFile.Get(volume)
-        volumeTree.Print()
-        if volumeTree.GetEntries()==0: continue
-
-        treeData, treeColumns = volumeTree.AsMatrix(return_labels=True)
-        treeDataFrame = pd.DataFrame(data=treeData, columns=treeColumns)
+        if rootFile: rootFile.Get(volume).Print()
+        treeDataFrame = readTree(options, rootFile, volume)
+        if len(treeDataFrame['energy'])==0: continue
 
         energySpectrum = rt.TH1F('HitEnergies'+volume, '', energyBins, energyBot, energyTop)
         if volume == 'conversion': energies = treeDataFrame['primaries']*primariesToEnergyScale + primariesToEnergyOffset
         else: energies = treeDataFrame['energy']
-        for energy in energies: energySpectrum.Fill(energy)
+        fillHistogram(energySpectrum, energies)
         #energySpectrum.Scale(1/energySpectrum.Integral(), 'width') # normalize spectrum
         energySpectrum.SetLineColor(volumeColors[i])
         legend.AddEntry(energySpectrum, volumeTitles[i], 'l')
@@ -0,0 +1,77 @@
+/// \file BenchmarkHarness.cc
+/// \brief Implementation of the BenchmarkHarness class
+
+#include "BenchmarkHarness.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void BenchmarkHarness::Add(std::string name, Function function) {
+  fBenchmarks.push_back({name, function});
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void BenchmarkHarness::Run(std::string filter, double minSeconds, int repetitions) {
+  typedef std::chrono::steady_clock Clock;
+  for (const Benchmark &benchmark:fBenchmarks) {
+    if (benchmark.name.find(filter)==std::string::npos) continue;
+
+    // batch size, also warms up the caches and lazy initialisations
+    int64_t iterations = 1;
+    double seconds = 0.;
+    while (true) {
+      Clock::time_point start = Clock::now();
+      benchmark.function(iterations);
+      seconds = std::chrono::duration<double>(Clock::now()-start).count();
+      if (seconds>=minSeconds || iterations>=(int64_t(1)<<40)) break;
+      // aim just above the minimum time, at most ten times more at once
+      double factor = seconds>0. ? std::min(10., 1.4*minSeconds/seconds) : 10.;
+      iterations = std::max(iterations+1, int64_t(iterations*factor));
+    }
+
+    std::vector<double> batchNs;
+    for (int repetition=0; repetition<repetitions; repetition++) {
+      Clock::time_point start = Clock::now();
+      benchmark.function(iterations);
+      batchNs.push_back(std::chrono::duration<double, std::nano>(Clock::now()-start).count()/iterations);
+    }
+    std::sort(batchNs.begin(), batchNs.end());
+    Result result = {benchmark.name, iterations, batchNs[batchNs.size()/2], batchNs.front(), batchNs.back()};
+    fResults.push_back(result);
+    std::cout << std::left << std::setw(36) << result.name << std::right << std::setw(14) << std::setprecision(4)
+              << result.medianNs << " ns" << std::setw(14) << result.iterations << " iterations" << std::endl;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool BenchmarkHarness::WriteJson(std::string path) const {
+  std::ofstream out(path);
+  if (!out) return false;
+  char date[32];
+  std::time_t now = std::time(0);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+  out << std::setprecision(8);
+  out << "{\n  \"context\": {\"date\": \"" << date << "\", \"num_cpus\": " << std::thread::hardware_concurrency() << "},\n";
+  out << "  \"benchmarks\": [";
+  std::string separator = "";
+  for (const Result &result:fResults) {
+    out << separator << "\n    {\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations;
+    out << ", \"real_time\": " << result.medianNs << ", \"min_time\": " << result.minNs << ", \"max_time\": " << result.maxNs;
+    out << ", \"time_unit\": \"ns\"}";
+    separator = ",";
+  }
+  out << "\n  ]\n}\n";
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
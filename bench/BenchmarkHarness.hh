@@ -0,0 +1,56 @@
+/// \file BenchmarkHarness.hh
+/// \brief Definition of the BenchmarkHarness class
+
+#ifndef BenchmarkHarness_h
+#define BenchmarkHarness_h 1
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/// Minimal microbenchmark runner for gem-xray-bench, so that the hot
+/// paths can be timed without an external benchmark library.
+///
+/// A benchmark is a function running a given number of iterations. The
+/// count grows towards 1.4 times the minimum time, by at most a factor of
+/// ten per trial, until a batch lasts the minimum time; then the batch is
+/// repeated and the median time per iteration reported. The JSON report
+/// uses the field names of Google Benchmark ("benchmarks", "name",
+/// "iterations", "real_time", "time_unit"), so the same comparison
+/// scripts work on either.
+
+class BenchmarkHarness
+{
+public:
+  typedef std::function<void(int64_t iterations)> Function;
+
+  void Add(std::string name, Function function);
+
+  // runs the benchmarks whose name contains filter, empty for all
+  void Run(std::string filter, double minSeconds, int repetitions);
+  bool WriteJson(std::string path) const;
+
+private:
+  struct Benchmark {
+    std::string name;
+    Function function;
+  };
+  struct Result {
+    std::string name;
+    int64_t iterations;
+    double medianNs, minNs, maxNs; // per iteration
+  };
+
+  std::vector<Benchmark> fBenchmarks;
+  std::vector<Result> fResults;
+};
+
+// keeps the compiler from dropping a computed value
+template <class T> inline void DoNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,219 @@
+/// \file gem-xray-bench.cc
+/// \brief Microbenchmarks of the simulation hot paths
+///
+/// Builds the same kernel as gem-xray for one geometry preset, then times
+/// the user actions called in isolation: primary generation for several
+/// sources, the stepping action on synthetic photon and electron steps,
+/// hit bookkeeping in the event action, ntuple filling, and HEED photon
+/// transport. Results go to stdout and to a JSON report in the Google
+/// Benchmark layout, see BenchmarkHarness.
+
+#include "BenchmarkHarness.hh"
+
+#include "DetectorConstructionBox.hh"
+#include "ActionInitialization.hh"
+#include "PhysicsList.hh"
+#include "RunAction.hh"
+#include "EventAction.hh"
+#include "SteppingAction.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "RunConfiguration.hh"
+#include "LayerDescription.hh"
+
+#include "G4RunManager.hh"
+#include "G4Run.hh"
+#include "G4Event.hh"
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4DynamicParticle.hh"
+#include "G4Gamma.hh"
+#include "G4Electron.hh"
+#include "G4Navigator.hh"
+#include "G4TransportationManager.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using std::string;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// a step of a track inside the placed volume, as the stepping action sees
+// it after transport; the track is past its first step unless registered
+struct SyntheticStep {
+  G4Track *track;
+  G4Step *step;
+};
+
+SyntheticStep MakeStep(G4String logicalName, G4ParticleDefinition *particle, G4double energy) {
+  G4ThreeVector position;
+  for (G4VPhysicalVolume *volume:*G4PhysicalVolumeStore::GetInstance())
+    if (volume->GetLogicalVolume()->GetName()==logicalName) position = volume->GetTranslation(); // envelope at the origin
+
+  G4Navigator *navigator = G4TransportationManager::GetTransportationManager()->GetNavigatorForTracking();
+  navigator->LocateGlobalPointAndSetup(position);
+  G4TouchableHandle touchable = navigator->CreateTouchableHistory();
+
+  G4Track *track = new G4Track(new G4DynamicParticle(particle, G4ThreeVector(0., 0., 1.), energy), 0., position);
+  track->SetTrackID(2);
+  track->SetParentID(1);
+  track->SetTouchableHandle(touchable);
+  track->SetNextTouchableHandle(touchable);
+  G4Step *step = new G4Step();
+  step->InitializeStep(track);
+  step->SetStepLength(1.*um);
+  track->SetStep(step);
+  track->IncrementCurrentStepNumber();
+  track->IncrementCurrentStepNumber();
+  return {track, step};
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+int main(int argc, char** argv) {
+  string argGeometry = "10x10";
+  string argPhysicsTables = "physics-tables";
+  string argFilter = ""; // substring of the benchmark names
+  string argOut = "gem-xray-bench.json";
+  double argMinTime = 0.2; // seconds per batch
+  int argRepetitions = 5;
+  for (int iarg=0; iarg<argc; iarg++) {
+    string argString = string(argv[iarg]);
+    if (argString=="--geometry") argGeometry = string(argv[iarg+1]);
+    else if (argString=="--physics-tables") argPhysicsTables = string(argv[iarg+1]);
+    else if (argString=="--filter") argFilter = string(argv[iarg+1]);
+    else if (argString=="--out") argOut = string(argv[iarg+1]);
+    else if (argString=="--min-time") argMinTime = std::atof(argv[iarg+1]);
+    else if (argString=="--repetitions") argRepetitions = std::max(1, std::atoi(argv[iarg+1]));
+  }
+
+  // same kernel as a headless gem-xray run, sequential and without output
+  RunConfiguration *configuration = RunConfiguration::Instance();
+  configuration->SetOutFilePath("");
+  G4Random::setTheEngine(new CLHEP::RanecuEngine);
+  G4Random::setTheSeed(1234);
+
+  LayerStack layers = GetLayerPreset(argGeometry);
+  G4RunManager *runManager = new G4RunManager;
+  runManager->SetUserInitialization(new DetectorConstructionBox(layers, false));
+  if (argPhysicsTables=="none") argPhysicsTables = "";
+  runManager->SetUserInitialization(new PhysicsList(layers, "livermore", -1.*mm, argPhysicsTables, false));
+  runManager->SetUserInitialization(new ActionInitialization(true, layers));
+  runManager->Initialize();
+  runManager->BeamOn(0);
+
+  RunAction *runAction = (RunAction *)runManager->GetUserRunAction();
+  EventAction *eventAction = (EventAction *)runManager->GetUserEventAction();
+  SteppingAction *steppingAction = (SteppingAction *)runManager->GetUserSteppingAction();
+  PrimaryGeneratorAction *generatorAction = (PrimaryGeneratorAction *)runManager->GetUserPrimaryGeneratorAction();
+
+  // the empty run skips the run action, whose trees the fills need
+  G4Run run;
+  runAction->BeginOfRunAction(&run);
+  G4Event event;
+  auto resetEvent = [&]() {
+    eventAction->BeginOfEventAction(&event);
+    eventAction->RegisterTrack(2, 1);
+  };
+  resetEvent();
+
+  // branches of the first layer and of the last one before the gas
+  G4String firstLayer = "", lastLayer = "";
+  G4int materialIndex = 0;
+  for (auto layer:layers) {
+    if (layer.material==G4String("vacuum")) continue;
+    materialIndex++;
+    lastLayer = layer.material+std::to_string(materialIndex);
+    if (firstLayer=="") firstLayer = lastLayer;
+  }
+
+  BenchmarkHarness harness;
+
+  for (string source:{"mono", "fe55", "xray", "phasespace"}) {
+    harness.Add("generate/"+source, [=](int64_t iterations) {
+      configuration->SetSource(source);
+      // the phasespace source reads an energy-angle table, not a spectrum
+      configuration->SetSpectrumPath(source=="phasespace" ? "phasespace-example.txt" : "xray-spectrum.csv");
+      generatorAction->Configure();
+      for (int64_t i=0; i<iterations; i++) {
+        G4Event generated(i);
+        generatorAction->GeneratePrimaries(&generated);
+      }
+    });
+  }
+
+  // photon inside a layer, photon leaving the last layer into the gas
+  // (hit and gas photon), electron entering the gas
+  SyntheticStep insideStep = MakeStep("Logical"+firstLayer, G4Gamma::Definition(), 8.*keV);
+  SyntheticStep leavingStep = MakeStep("Logical"+lastLayer, G4Gamma::Definition(), 8.*keV);
+  leavingStep.step->SetLastStepFlag();
+  SyntheticStep electronStep = MakeStep("DriftGapLogical", G4Electron::Definition(), 3.*keV);
+  electronStep.step->SetFirstStepFlag();
+  struct { string name; SyntheticStep step; } steppingCases[] = {
+    {"stepping/photon-inside", insideStep}, {"stepping/photon-leaving", leavingStep}, {"stepping/electron-gas", electronStep}};
+  for (auto steppingCase:steppingCases) {
+    SyntheticStep step = steppingCase.step;
+    harness.Add(steppingCase.name, [=](int64_t iterations) {
+      for (int64_t i=0; i<iterations; i++) {
+        if ((i&4095)==4095) resetEvent(); // hits pile up otherwise
+        steppingAction->UserSteppingAction(step.step);
+      }
+      resetEvent();
+    });
+  }
+
+  harness.Add("event/add-hit", [=](int64_t iterations) {
+    for (int64_t i=0; i<iterations; i++) {
+      if ((i&4095)==4095) resetEvent();
+      eventAction->AddHit(firstLayer, 8.04, 1.);
+    }
+    resetEvent();
+  });
+  harness.Add("event/add-photon", [=](int64_t iterations) {
+    for (int64_t i=0; i<iterations; i++) {
+      if ((i&4095)==4095) resetEvent();
+      eventAction->AddPhoton(8.04, G4ThreeVector(), G4ThreeVector(0., 0., 1.), 1.);
+    }
+    resetEvent();
+  });
+
+  // each batch starts a new run, the in-memory trees would grow without bound
+  harness.Add("run/fill-hit", [=, &run](int64_t iterations) {
+    runAction->EndOfRunAction(&run);
+    runAction->BeginOfRunAction(&run);
+    for (int64_t i=0; i<iterations; i++) runAction->FillNtuples(firstLayer, 8.04);
+  });
+  harness.Add("run/fill-conversion", [=, &run](int64_t iterations) {
+    runAction->EndOfRunAction(&run);
+    runAction->BeginOfRunAction(&run);
+    for (int64_t i=0; i<iterations; i++) runAction->FillNtuples("conversion", 7.4, 230);
+  });
+
+  for (G4double energy:{6., 22., 40.}) {
+    harness.Add("heed/photon-"+std::to_string((int)energy)+"keV", [=](int64_t iterations) {
+      G4int primaries = 0;
+      for (int64_t i=0; i<iterations; i++)
+        primaries += runAction->heedSimulation->TransportPhoton(eventAction, energy, G4ThreeVector(), G4ThreeVector(0., 0., 1.));
+      DoNotOptimize(primaries);
+    });
+  }
+
+  harness.Run(argFilter, argMinTime, argRepetitions);
+  runAction->EndOfRunAction(&run);
+  if (!harness.WriteJson(argOut)) {
+    std::cerr << "Cannot write " << argOut << std::endl;
+    return 1;
+  }
+  std::cout << "Results written to " << argOut << std::endl;
+
+  delete runManager;
+  return 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
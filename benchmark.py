@@ -0,0 +1,332 @@
+#!/usr/bin/python3
+
+import os, sys
+import argparse
+import json
+import subprocess
+import tempfile
+
+def chi2_distance(a, b):
+    ''' Chi-square per bin between two unnormalized histograms '''
+    totalA, totalB = sum(a), sum(b)
+    if totalA==0 or totalB==0: return None
+    chi2, ndf = 0., 0
+    for ai, bi in zip(a, b):
+        if ai+bi==0: continue
+        chi2 += (totalB*ai-totalA*bi)**2/(ai+bi)
+        ndf += 1
+    if ndf<=1: return None
+    return chi2/(totalA*totalB)/(ndf-1)
+
+def run(options, workDir, tag, arguments):
+    ''' Runs gem-xray on the benchmark configuration and returns its summary '''
+    macroPath = os.path.join(workDir, 'benchmark.mac')
+    summaryPath = os.path.join(workDir, tag+'.json')
+    with open(macroPath, 'w') as macroFile:
+        macroFile.write('/run/initialize\n/run/beamOn %d\n'%options.events)
+
+    command = [options.executable, '--geometry', options.geometry, '--spectrum', options.spectrum,
+        '--seed', str(options.seed), '--physics-tables', 'none', '--result-cache', 'none', '--out', '', '--summary', summaryPath, '--run', macroPath]
+    command += arguments
+    if options.verbose: print(' '.join(command))
+    subprocess.run(command, check=True, stdout=None if options.verbose else subprocess.DEVNULL)
+
+    with open(summaryPath) as summaryFile: return json.load(summaryFile)
+
+def figure_of_merit(summary, histogramName, reference):
+    ''' 1/(relative variance * seconds), the relative variance averaged
+    over the bins filled in the reference histogram '''
+    histogram = summary['histograms'][histogramName]
+    relativeVariances = list()
+    for content, sumw2, referenceContent in zip(histogram['contents'], histogram['sumw2'], reference['histograms'][histogramName]['contents']):
+        if referenceContent<=0 or content<=0: continue
+        relativeVariances.append(sumw2/content**2)
+    if len(relativeVariances)==0: return None
+    return 1/(sum(relativeVariances)/len(relativeVariances)*summary['seconds'])
+
+def compatibility(a, b, histogramName):
+    ''' Chi-square per bin between two weighted histograms of the same number of events '''
+    chi2, ndf = 0., 0
+    histogramA, histogramB = a['histograms'][histogramName], b['histograms'][histogramName]
+    for ai, vi, bi, wi in zip(histogramA['contents'], histogramA['sumw2'], histogramB['contents'], histogramB['sumw2']):
+        if vi+wi<=0: continue
+        chi2 += (ai-bi)**2/(vi+wi)
+        ndf += 1
+    return chi2/ndf if ndf>0 else None
+
+def physics(options):
+    results = list()
+    with tempfile.TemporaryDirectory() as workDir:
+        for emOption in options.em_options:
+            for cut in options.cuts:
+                print('Running %s with %g mm cut...'%(emOption, cut))
+                result = run(options, workDir, '%s-%g'%(emOption, cut), ['--em-option', emOption, '--cut', str(cut)])
+                result['em_option'], result['cut_mm'] = emOption, cut
+                results.append(result)
+
+    reference = results[0]
+    report = {
+        'geometry': options.geometry, 'spectrum': options.spectrum,
+        'events': options.events, 'seed': options.seed,
+        'reference': {'em_option': reference['em_option'], 'cut_mm': reference['cut_mm']},
+        'configurations': list()
+    }
+    for result in results:
+        layerChi2 = dict()
+        for name, histogram in result['histograms'].items():
+            if name not in reference['histograms']: continue
+            layerChi2[name] = chi2_distance(reference['histograms'][name]['contents'], histogram['contents'])
+        report['configurations'].append({
+            'em_option': result['em_option'], 'cut_mm': result['cut_mm'],
+            'events_per_second': result['events_per_second'],
+            'peak_rss_kb': result['peak_rss_kb'],
+            'chi2_ndf': layerChi2
+        })
+        print('%-10s %8g mm %12.1f events/s %10d kB'%(result['em_option'], result['cut_mm'], result['events_per_second'], result['peak_rss_kb']))
+
+    return report
+
+def forced(options):
+    with tempfile.TemporaryDirectory() as workDir:
+        print('Running analog conversion...')
+        analog = run(options, workDir, 'analog', [])
+        print('Running forced conversion...')
+        forcedConversion = run(options, workDir, 'forced', ['--forced-conversion'])
+
+    report = {
+        'geometry': options.geometry, 'spectrum': options.spectrum,
+        'events': options.events, 'seed': options.seed,
+        'configurations': list()
+    }
+    for name, result in (('analog', analog), ('forced', forcedConversion)):
+        report['configurations'].append({
+            'mode': name, 'seconds': result['seconds'],
+            'conversions': sum(result['histograms']['primaries']['contents']),
+            'fom': figure_of_merit(result, 'primaries', analog)
+        })
+        print('%-8s %10.1f s FOM %s'%(name, result['seconds'], report['configurations'][-1]['fom']))
+    analogFom, forcedFom = (c['fom'] for c in report['configurations'])
+    report['fom_gain'] = forcedFom/analogFom if analogFom and forcedFom else None
+    report['chi2_ndf'] = compatibility(analog, forcedConversion, 'primaries')
+    print('FOM gain on the primaries spectrum', report['fom_gain'], 'chi2/ndf to analog', report['chi2_ndf'])
+    return report
+
+def importance(options):
+    with tempfile.TemporaryDirectory() as workDir:
+        print('Running analog transport...')
+        # biased conversions are filled per gas particle, so is the reference
+        analog = run(options, workDir, 'analog', ['--stack', options.stack, '--no-biasing', '--particle-conversions'])
+        print('Running importance biasing...')
+        biased = run(options, workDir, 'biased', ['--stack', options.stack])
+
+    report = {
+        'stack': options.stack, 'spectrum': options.spectrum,
+        'events': options.events, 'seed': options.seed,
+        'analog_seconds': analog['seconds'], 'biased_seconds': biased['seconds'],
+        'histograms': dict()
+    }
+    for name in analog['histograms']:
+        analogFom = figure_of_merit(analog, name, analog)
+        biasedFom = figure_of_merit(biased, name, analog)
+        report['histograms'][name] = {
+            'analog_fom': analogFom, 'biased_fom': biasedFom,
+            'fom_gain': biasedFom/analogFom if analogFom and biasedFom else None,
+            'chi2_ndf': compatibility(analog, biased, name)
+        }
+        print('%-12s FOM gain %s chi2/ndf to analog %s'%(name, report['histograms'][name]['fom_gain'], report['histograms'][name]['chi2_ndf']))
+    return report
+
+def perturb_stack(stackPath, perturbedPath, branch, delta):
+    ''' Copies a layer file with the thickness of one layer, named as its
+    histogram branch (material and index of the non-vacuum layer), scaled by 1+delta;
+    returns the branch names of the stack '''
+    materialIndex = 0
+    branches = list()
+    with open(stackPath) as stackFile, open(perturbedPath, 'w') as perturbedFile:
+        for line in stackFile:
+            fields = line.split()
+            if len(fields)>=2 and not fields[0].startswith('#') and fields[0]!='vacuum':
+                materialIndex += 1
+                branches.append(fields[0]+str(materialIndex))
+                if branches[-1]==branch:
+                    fields[1] = '%.9g'%(float(fields[1])*(1+delta))
+                    line = ' '.join(fields)+'\n'
+            perturbedFile.write(line)
+    return branches
+
+def sensitivity(options):
+    name = 'primaries_d'+options.layer
+    with tempfile.TemporaryDirectory() as workDir:
+        perturbedPath = os.path.join(workDir, 'perturbed.txt')
+        branches = perturb_stack(options.stack, perturbedPath, options.layer, options.delta)
+        if options.layer not in branches:
+            sys.exit('No layer %s in %s, its branches are %s'%(options.layer, options.stack, ', '.join(branches)))
+        print('Running with sensitivity scores...')
+        nominal = run(options, workDir, 'nominal', ['--stack', options.stack, '--no-biasing', '--sensitivity'])
+        print('Running with %s scaled by %g...'%(options.layer, 1+options.delta))
+        perturbed = run(options, workDir, 'perturbed', ['--stack', perturbedPath, '--no-biasing'])
+
+    # first order prediction of the perturbed spectrum against the rerun
+    derivative, nominalHistogram, perturbedHistogram = (s['histograms'][n] for s, n in ((nominal, name), (nominal, 'primaries'), (perturbed, 'primaries')))
+    chi2, ndf = 0., 0
+    predictedError, differenceError = 0., 0.
+    for d, dw2, a, aw2, b, bw2 in zip(derivative['contents'], derivative['sumw2'], nominalHistogram['contents'],
+            nominalHistogram['sumw2'], perturbedHistogram['contents'], perturbedHistogram['sumw2']):
+        predictedError += options.delta**2*dw2
+        differenceError += aw2+bw2
+        if aw2+bw2<=0: continue
+        chi2 += (b-a-options.delta*d)**2/(options.delta**2*dw2+aw2+bw2)
+        ndf += 1
+
+    report = {
+        'stack': options.stack, 'layer': options.layer, 'delta': options.delta,
+        'spectrum': options.spectrum, 'events': options.events, 'seed': options.seed,
+        'predicted_change': options.delta*sum(derivative['contents']),
+        'predicted_change_error': predictedError**0.5,
+        'rerun_change': sum(perturbedHistogram['contents'])-sum(nominalHistogram['contents']),
+        'rerun_change_error': differenceError**0.5,
+        'chi2_ndf': chi2/ndf if ndf>0 else None
+    }
+    print('Change of the primaries entries: predicted %g +- %g, rerun %g +- %g, chi2/ndf %s'%(
+        report['predicted_change'], report['predicted_change_error'],
+        report['rerun_change'], report['rerun_change_error'], report['chi2_ndf']))
+    return report
+
+def replica_error(summaries, histogramName):
+    ''' Statistical error of a spectrum per event, from the spread of
+    independent replicas: square root of the summed bin variances '''
+    spectra = [[c/s['photons'] for c in s['histograms'][histogramName]['contents']] for s in summaries]
+    n = len(spectra)
+    variance = 0.
+    for contents in zip(*spectra):
+        mean = sum(contents)/n
+        variance += sum((c-mean)**2 for c in contents)/(n-1)
+    return variance**0.5
+
+def plot_convergence(report, outputPrefix):
+    ''' Log-log error against events, one plot per histogram '''
+    import ROOT as rt
+    rt.gROOT.SetBatch(True)
+    for name, errors in report['histograms'].items():
+        canvas = rt.TCanvas('c'+name, '', 800, 600)
+        canvas.SetLogx()
+        canvas.SetLogy()
+        graphs = dict()
+        multiGraph = rt.TMultiGraph()
+        legend = rt.TLegend(0.6, 0.75, 0.88, 0.88)
+        for color, mode in ((rt.kBlack, 'analog'), (rt.kRed, 'quasi_random')):
+            graphs[mode] = rt.TGraph()
+            for point, (events, error) in enumerate(zip(report['events'], errors[mode])): graphs[mode].SetPoint(point, events, error)
+            graphs[mode].SetMarkerStyle(20)
+            graphs[mode].SetMarkerColor(color)
+            graphs[mode].SetLineColor(color)
+            multiGraph.Add(graphs[mode], 'lp')
+            legend.AddEntry(graphs[mode], mode.replace('_', '-'), 'lp')
+        multiGraph.SetTitle(name+';Events;Error of the spectrum per event')
+        multiGraph.Draw('a')
+        legend.Draw()
+        canvas.SaveAs('%s-%s.png'%(outputPrefix, name))
+
+def qmc(options):
+    summaries = {'analog': dict(), 'quasi_random': dict()}
+    seed = options.seed
+    with tempfile.TemporaryDirectory() as workDir:
+        for events in options.event_counts:
+            options.events = events
+            for mode, arguments in (('analog', []), ('quasi_random', ['--quasi-random'])):
+                print('Running %d replicas of %d events, %s...'%(options.replicas, events, mode))
+                summaries[mode][events] = list()
+                for replica in range(options.replicas):
+                    options.seed = seed+replica
+                    summaries[mode][events].append(run(options, workDir, '%s-%d-%d'%(mode, events, replica), arguments))
+    options.seed = seed
+
+    report = {
+        'geometry': options.geometry, 'spectrum': options.spectrum,
+        'seed': options.seed, 'replicas': options.replicas,
+        'events': options.event_counts, 'histograms': dict()
+    }
+    firstSummary = summaries['analog'][options.event_counts[0]][0]
+    for name in firstSummary['histograms']:
+        errors = {mode: [replica_error(summaries[mode][events], name) for events in options.event_counts] for mode in summaries}
+        # events of the analog run for the accuracy of the largest quasi-random run
+        analogError, quasiRandomError = errors['analog'][-1], errors['quasi_random'][-1]
+        errors['event_ratio'] = (analogError/quasiRandomError)**2 if quasiRandomError>0 else None
+        report['histograms'][name] = errors
+        print('%-12s analog %s quasi-random %s event ratio %s'%(name, analogError, quasiRandomError, errors['event_ratio']))
+
+    plot_convergence(report, os.path.splitext(options.output)[0])
+    return report
+
+def multiphoton(options):
+    photons = options.events
+    results = dict()
+    with tempfile.TemporaryDirectory() as workDir:
+        for photonsPerEvent in options.photons_per_event:
+            options.events = photons//photonsPerEvent
+            print('Running %d events of %d photons...'%(options.events, photonsPerEvent))
+            results[photonsPerEvent] = run(options, workDir, 'k%d'%photonsPerEvent, ['--photons-per-event', str(photonsPerEvent)])
+    options.events = photons
+
+    reference = results[options.photons_per_event[0]]
+    report = {
+        'geometry': options.geometry, 'spectrum': options.spectrum,
+        'photons': photons, 'seed': options.seed,
+        'configurations': list()
+    }
+    for photonsPerEvent, result in results.items():
+        # same photons in every configuration, the histograms must agree
+        report['configurations'].append({
+            'photons_per_event': photonsPerEvent,
+            'photons_per_second': result['photons_per_second'],
+            'speedup': result['photons_per_second']/reference['photons_per_second'],
+            'chi2_ndf': {name: compatibility(reference, result, name) for name in result['histograms']}
+        })
+        print('%4d photons per event %12.1f photons/s speedup %.3f'%(photonsPerEvent, result['photons_per_second'], report['configurations'][-1]['speedup']))
+    return report
+
+def main():
+    ap = argparse.ArgumentParser(add_help=True)
+    ap.add_argument('-o', '--output', default='benchmark.json')
+    ap.add_argument('--executable', default='./gem-xray')
+    ap.add_argument('--geometry', default='10x10')
+    ap.add_argument('--spectrum', default='xray')
+    ap.add_argument('--events', type=int, default=100000)
+    ap.add_argument('--seed', type=int, default=12345)
+    ap.add_argument('-v', '--verbose', action='store_true')
+    subparsers = ap.add_subparsers(dest='benchmark')
+    subparsers.required = True
+
+    physicsParser = subparsers.add_parser('physics', help='EM options and production cuts')
+    physicsParser.add_argument('--em-options', nargs='+', default=['livermore', 'penelope', 'option4'], help='first one is the reference')
+    physicsParser.add_argument('--cuts', nargs='+', type=float, default=[0.01, 0.1, 0.7], help='production cuts in mm, first one is the reference')
+
+    subparsers.add_parser('forced', help='forced gas conversion against analog')
+
+    importanceParser = subparsers.add_parser('importance', help='layer importance biasing against analog')
+    importanceParser.add_argument('--stack', default='stack-importance.txt', help='layer file with importances')
+
+    sensitivityParser = subparsers.add_parser('sensitivity', help='density derivative scores against a rerun with a thicker layer')
+    sensitivityParser.add_argument('--stack', default='stack-example.txt', help='layer file')
+    sensitivityParser.add_argument('--layer', default='copper6', help='histogram branch of the perturbed layer')
+    sensitivityParser.add_argument('--delta', type=float, default=0.2, help='relative thickness change of the rerun')
+
+    qmcParser = subparsers.add_parser('qmc', help='convergence of quasi-random against pseudo-random primaries')
+    qmcParser.add_argument('--event-counts', nargs='+', type=int, default=[1000, 4000, 16000, 64000])
+    qmcParser.add_argument('--replicas', type=int, default=8, help='independent runs per point, for the error')
+
+    multiphotonParser = subparsers.add_parser('multiphoton', help='photon throughput against primary photons per event')
+    multiphotonParser.add_argument('--photons-per-event', nargs='+', type=int, default=[1, 2, 4, 8, 16, 32, 64], help='first one is the reference')
+    options = ap.parse_args(sys.argv[1:])
+
+    if options.benchmark=='physics': report = physics(options)
+    elif options.benchmark=='forced': report = forced(options)
+    elif options.benchmark=='importance': report = importance(options)
+    elif options.benchmark=='sensitivity': report = sensitivity(options)
+    elif options.benchmark=='qmc': report = qmc(options)
+    elif options.benchmark=='multiphoton': report = multiphoton(options)
+
+    with open(options.output, 'w') as outputFile: json.dump(report, outputFile, indent=2)
+    print('Report written to', options.output)
+
+if __name__=='__main__': main()
@@ -0,0 +1,42 @@
+#!/usr/bin/python3
+
+import os, sys
+import argparse
+import socket
+
+def main():
+    ap = argparse.ArgumentParser(add_help=True, description='Submit a job to gem-xray --serve')
+    ap.add_argument('-s', '--socket', default='gem-xray.sock')
+    ap.add_argument('job', nargs='+', help='key=value pairs, e.g. source=fe55 events=10000, or quit')
+    ap.add_argument('-o', '--output', help='write the returned histograms as csv files in this directory')
+    options = ap.parse_args(sys.argv[1:])
+
+    client = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    client.connect(options.socket)
+    client.sendall((' '.join(options.job)+'\n').encode())
+    reply = b''
+    while not reply.endswith(b'end\n'):
+        data = client.recv(65536)
+        if not data: break
+        reply += data
+    client.close()
+
+    lines = reply.decode().splitlines()
+    print(lines[0])
+    if not lines[0].startswith('ok'): sys.exit(1)
+
+    histograms = dict()
+    for header,contents in zip(lines[1:-1:2], lines[2:-1:2]):
+        _, name, bins, low, high = header.split()
+        histograms[name] = (int(bins), float(low), float(high), [float(c) for c in contents.split()])
+        print('%s: %d entries'%(name, sum(histograms[name][3])))
+
+    if options.output:
+        try: os.makedirs(options.output)
+        except FileExistsError: pass
+        for name,(bins,low,high,contents) in histograms.items():
+            width = (high-low)/bins
+            with open('%s/%s.csv'%(options.output, name), 'w') as histogramFile:
+                for i,content in enumerate(contents): histogramFile.write('%g, %g\n'%(low+(i+0.5)*width, content))
+
+if __name__=='__main__': main()
@@ -0,0 +1,103 @@
+/// \file gem-xray-unfold.cc
+/// \brief Unfolding of a measured primaries spectrum with a detector response
+///
+/// Recovers the photon spectrum from a measured spectrum of conversion
+/// primaries, given the matrix written by gem-xray --response-build.
+/// The measured spectrum has one "primaries, counts" line per bin, or
+/// only the counts in the binning of the matrix output. The result has
+/// one "energy, content" line per input bin, like xray-spectrum.csv, so
+/// that it can be given back to gem-xray with --spectrum-file.
+/// No Geant4 is needed.
+
+#include "ResponseMatrix.hh"
+#include "Unfolding.hh"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+bool ReadMeasured(string path, const ResponseMatrix &matrix, vector<double> &measured) {
+  ifstream measuredFile(path);
+  if (!measuredFile) return false;
+  measured.assign(matrix.GetNOut(), 0.);
+  double width = (matrix.GetOutMax()-matrix.GetOutMin())/matrix.GetNOut();
+  string line;
+  int sequentialBin = 0;
+  while (getline(measuredFile, line)) {
+    if (line.empty() || line[0]=='#') continue;
+    for (char &c : line) if (c==',') c = ' ';
+    istringstream lineStream(line);
+    double first, second;
+    if (!(lineStream >> first)) continue;
+    if (lineStream >> second) {
+      int bin = floor((first-matrix.GetOutMin())/width);
+      if (bin>=0 && bin<matrix.GetNOut()) measured[bin] += second;
+    }
+    else if (sequentialBin<matrix.GetNOut()) measured[sequentialBin++] = first;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  string argResponse = "";
+  string argMeasured = "";
+  string argOut = "unfolded-spectrum.csv";
+  string argMethod = "mlem"; // mlem or tikhonov
+  int argIterations = 100;
+  double argRegularisation = 1e-3;
+  int argThreads = thread::hardware_concurrency();
+
+  for (int iarg=0; iarg<argc; iarg++) {
+    string argString = string(argv[iarg]);
+    if (argString=="--response") argResponse = string(argv[iarg+1]);
+    else if (argString=="--measured") argMeasured = string(argv[iarg+1]);
+    else if (argString=="--out") argOut = string(argv[iarg+1]);
+    else if (argString=="--method") argMethod = string(argv[iarg+1]);
+    else if (argString=="--iterations") argIterations = atoi(argv[iarg+1]);
+    else if (argString=="--regularisation") argRegularisation = atof(argv[iarg+1]);
+    else if (argString=="--threads") argThreads = atoi(argv[iarg+1]);
+  }
+  if (argResponse=="" || argMeasured=="" || (argMethod!="mlem" && argMethod!="tikhonov")) {
+    cerr << "Usage: gem-xray-unfold --response matrix --measured spectrum [--out file]" << endl;
+    cerr << "  [--method mlem|tikhonov] [--iterations n] [--regularisation a] [--threads n]" << endl;
+    return 1;
+  }
+
+  ResponseMatrix matrix;
+  if (!matrix.Read(argResponse)) {
+    cerr << "Cannot read response matrix " << argResponse << endl;
+    return 1;
+  }
+  vector<double> measured;
+  if (!ReadMeasured(argMeasured, matrix, measured)) {
+    cerr << "Cannot read measured spectrum " << argMeasured << endl;
+    return 1;
+  }
+
+  auto start = chrono::steady_clock::now();
+  Unfolding unfolding(matrix, argThreads);
+  vector<double> unfolded;
+  if (argMethod=="mlem") unfolded = unfolding.Mlem(measured, argIterations);
+  else unfolded = unfolding.Tikhonov(measured, argRegularisation, argIterations);
+  chrono::duration<double> elapsed = chrono::steady_clock::now()-start;
+
+  ofstream outFile(argOut);
+  outFile << setprecision(9);
+  for (int in=0; in<matrix.GetNIn(); in++) outFile << matrix.GetInCenter(in) << ", " << unfolded[in] << "\n";
+  outFile.close();
+
+  cout << "Unfolded " << matrix.GetNOut() << " into " << matrix.GetNIn() << " bins with " << argMethod;
+  cout << ", " << argIterations << " iterations, " << argThreads << " threads, in " << elapsed.count() << " s" << endl;
+  cout << "chi2/ndf " << unfolding.Chi2(measured, unfolded)/max(1, matrix.GetNOut()-1) << endl;
+  cout << "Unfolded spectrum written to " << argOut << endl;
+  return 0;
+}
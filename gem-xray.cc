@@ -32,7 +32,17 @@
 #include "DetectorConstruction10x10.hh"
 #include "DetectorConstructionME0.hh"
 #include "ActionInitialization.hh"
+#include "RunAction.hh"
 #include "PhysicsList.hh"
+#include "RunConfiguration.hh"
+#include "JobServer.hh"
+#include "LayerDescription.hh"
+#include "StartupProfile.hh"
+#include "TransferMatrixCache.hh"
+#include "DetectorResponse.hh"
+#include "SlowEventList.hh"
+#include "ResultCache.hh"
+#include "Logger.hh"
 
 #ifdef G4MULTITHREADED
 #include "G4MTRunManager.hh"
@@ -47,6 +57,10 @@
 #include "G4UIExecutive.hh"
 
 #include "Randomize.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <cstdlib>
 
 using std::cout;
 using std::endl;
@@ -64,19 +78,191 @@ int main(int argc,char** argv)
   string argRun = "run1.mac"; // command file with .mac extension
   string argOut = "temp.root";
   string argGeometry = "10x10"; // 10x10, ME0 or custom
-  string argSource = "xray"; // fe55, cd109 or xray
+  string argStack = ""; // layer file, overrides --geometry
+  string argSource = "xray"; // name in sources/ (fe55, cd109, xray, phasespace...), .src path or mono
+  string argSpectrumFile = "xray-spectrum.csv";
+  string argServe = ""; // socket path, keeps running and accepts jobs
+  string argPhysicsTables = "physics-tables"; // none to always rebuild
+  string argEmOption = "livermore"; // livermore, penelope or option4
+  double argCut = -1.; // default production cut in mm
+  long argSeed = -1;
+  string argSummary = ""; // JSON run summary
+  string argColumns = ""; // directory of raw column files, alongside the ROOT output
+  string argStatusFile = ""; // progress file rewritten during the run
+  double argStatusInterval = 10.; // seconds between rewrites
+  string argSpot = ""; // focal-spot image, point source if empty
+  double argTubeVoltage = 50.; // kV, spectrum of a library source
+  bool startupProfile = false;
+  bool forcedConversion = false; // weighted, every gas photon converts
+  bool noBiasing = false; // ignore the layer importances
+  int photonsPerEvent = 1; // independent primaries per event
+  bool quasiRandom = false; // scrambled Sobol primary energies and directions
+  bool sensitivity = false; // primaries derivatives with respect to the layer densities
+  bool particleConversions = false; // one conversion entry per gas particle, as with biasing
+  string argAnalytic = ""; // only write the analytic uncollided spectra
+  string argTransferBuild = ""; // cache directory, build the matrix of a one-layer stack
+  string argTransferCompose = ""; // cache directory, compose the stack without Geant4
+  string argTransferOut = "transfer-spectra.json";
+  int argTransferEvents = 10000; // per incident energy
+  string argResponseBuild = ""; // detector response matrix to build
+  int argResponseBins = 120; // incident energies of the response scan
+  double argResponseMin = 0., argResponseMax = 60.; // keV
+  string argFold = ""; // detector response to fold the source with, no Geant4
+  string argFoldOut = "folded-primaries.json";
+  int argSlowEvents = 0; // slowest events written for replay
+  string argReplayEvent = ""; // slow event file to run again, e.g. under a profiler
+  int argReplayRepeat = 1; // times the replayed event is run
+  string argLogLevel = "info"; // debug, info, warning or error
+  string argResultCache = "result-cache"; // finished seeded runs, none to disable
+  bool forceRun = false; // run even if the result is cached
   for (int iarg=0; iarg<argc; iarg++) {
     string argString = string(argv[iarg]);
     if (argString=="--gui") headless = false;
     else if (argString=="--run") argRun = string(argv[iarg+1]);
     else if (argString=="--out") argOut = string(argv[iarg+1]);
     else if (argString=="--geometry") argGeometry = string(argv[iarg+1]);
+    else if (argString=="--stack") argStack = string(argv[iarg+1]);
     else if (argString=="--spectrum") argSource = string(argv[iarg+1]);
+    else if (argString=="--spectrum-file") argSpectrumFile = string(argv[iarg+1]);
+    else if (argString=="--serve") argServe = string(argv[iarg+1]);
+    else if (argString=="--physics-tables") argPhysicsTables = string(argv[iarg+1]);
+    else if (argString=="--em-option") argEmOption = string(argv[iarg+1]);
+    else if (argString=="--cut") argCut = std::atof(argv[iarg+1]);
+    else if (argString=="--seed") argSeed = std::atol(argv[iarg+1]);
+    else if (argString=="--summary") argSummary = string(argv[iarg+1]);
+    else if (argString=="--columns") argColumns = string(argv[iarg+1]);
+    else if (argString=="--status-file") argStatusFile = string(argv[iarg+1]);
+    else if (argString=="--status-interval") argStatusInterval = std::max(0.1, std::atof(argv[iarg+1]));
+    else if (argString=="--spot") argSpot = string(argv[iarg+1]);
+    else if (argString=="--kv") argTubeVoltage = std::atof(argv[iarg+1]);
+    else if (argString=="--startup-profile") startupProfile = true;
+    else if (argString=="--forced-conversion") forcedConversion = true;
+    else if (argString=="--no-biasing") noBiasing = true;
+    else if (argString=="--sensitivity") sensitivity = true;
+    else if (argString=="--particle-conversions") particleConversions = true;
+    else if (argString=="--quasi-random") quasiRandom = true;
+    else if (argString=="--photons-per-event") photonsPerEvent = std::max(1, std::atoi(argv[iarg+1]));
+    else if (argString=="--analytic") argAnalytic = string(argv[iarg+1]);
+    else if (argString=="--transfer-build") argTransferBuild = string(argv[iarg+1]);
+    else if (argString=="--transfer-compose") argTransferCompose = string(argv[iarg+1]);
+    else if (argString=="--transfer-out") argTransferOut = string(argv[iarg+1]);
+    else if (argString=="--transfer-events") argTransferEvents = std::atoi(argv[iarg+1]);
+    else if (argString=="--response-build") argResponseBuild = string(argv[iarg+1]);
+    else if (argString=="--response-grid") {
+      argResponseBins = std::atoi(argv[iarg+1]);
+      argResponseMin = std::atof(argv[iarg+2]);
+      argResponseMax = std::atof(argv[iarg+3]);
+    }
+    else if (argString=="--fold") argFold = string(argv[iarg+1]);
+    else if (argString=="--fold-out") argFoldOut = string(argv[iarg+1]);
+    else if (argString=="--slow-events") argSlowEvents = std::atoi(argv[iarg+1]);
+    else if (argString=="--replay-event") argReplayEvent = string(argv[iarg+1]);
+    else if (argString=="--result-cache") argResultCache = string(argv[iarg+1]);
+    else if (argString=="--force") forceRun = true;
+    else if (argString=="--log-level") argLogLevel = string(argv[iarg+1]);
+    else if (argString=="--replay-repeat") argReplayRepeat = std::max(1, std::atoi(argv[iarg+1]));
+  }
+  if (argServe!="") {
+    headless = true;
+    // the macro only sets up the kernel, jobs come from the socket
+    if (argRun=="run1.mac") argRun = "serve.mac";
+    argOut = "";
+  }
+
+  StartupProfile::Instance()->SetEnabled(startupProfile);
+  if (!Logger::Instance()->SetLevel(G4String(argLogLevel))) {
+    G4ExceptionDescription msg;
+    msg << "Unknown log level " << argLogLevel << ", use debug, info, warning or error";
+    G4Exception("main()", "MyCode0007", FatalException, msg);
+  }
+
+  if (argAnalytic!="" || argTransferBuild!="" || argResponseBuild!="") argOut = "";
+
+  RunConfiguration *configuration = RunConfiguration::Instance();
+  configuration->SetSource(argSource);
+  configuration->SetSpectrumPath(argSpectrumFile);
+  configuration->SetSpotPath(argSpot);
+  configuration->SetTubeVoltage(argTubeVoltage);
+  configuration->SetOutFilePath(argOut);
+  configuration->SetSummaryPath(argSummary);
+  configuration->SetColumnsPath(argColumns);
+  configuration->SetStatusPath(argStatusFile);
+  configuration->SetStatusInterval(argStatusInterval);
+  configuration->SetForcedConversion(forcedConversion);
+  configuration->SetPhotonsPerEvent(photonsPerEvent);
+  configuration->SetQuasiRandom(quasiRandom);
+  if (argSeed>=0) configuration->SetQuasiRandomSeed(argSeed);
+  configuration->SetSlowEvents(argSlowEvents);
+
+  // the replayed event brings its own source settings
+  if (argReplayEvent!="") {
+    SlowEvent replayEvent;
+    if (!SlowEventList::Read(argReplayEvent, replayEvent)) {
+      G4ExceptionDescription msg;
+      msg << "Cannot read slow event " << argReplayEvent;
+      G4Exception("main()", "MyCode0006", FatalException, msg);
+    }
+    configuration->SetReplayEvent(replayEvent);
+    configuration->SetSource(replayEvent.source);
+    if (replayEvent.spectrumPath!="") configuration->SetSpectrumPath(replayEvent.spectrumPath);
+    configuration->SetTubeVoltage(replayEvent.tubeVoltage);
+    configuration->SetSpotPath(replayEvent.spotPath);
+    configuration->SetPhotonsPerEvent(replayEvent.photonsPerEvent);
+    configuration->SetForcedConversion(replayEvent.forcedConversion);
+    configuration->SetQuasiRandom(replayEvent.quasiRandom);
+    configuration->SetQuasiRandomSeed(replayEvent.quasiRandomSeed);
+    noBiasing = !replayEvent.importanceBiasing; // splitting draws too
+    if (replayEvent.threads>1)
+      G4cout << "Event recorded with " << replayEvent.threads << " threads, its HEED part may differ" << G4endl;
+    configuration->SetSlowEvents(0);
+    configuration->SetOutFilePath("");
+    headless = true;
+  }
+
+  // layer stack from a preset or from a layer file
+  LayerStack exampleMaterialLayers;
+  if (argStack!="") exampleMaterialLayers = ReadLayerFile(argStack);
+  else exampleMaterialLayers = GetLayerPreset(argGeometry);
+
+  // folding and composing need no kernel, building transfer matrices is skipped if cached
+  if (argFold!="") {
+    FoldDetectorResponse(argFold, argSource, argSpectrumFile, argFoldOut);
+    return 0;
+  }
+  if (argTransferCompose!="") {
+    TransferMatrixCache(argTransferCompose, argEmOption, argCut).Compose(exampleMaterialLayers, argSource, argSpectrumFile, argTransferOut);
+    return 0;
+  }
+  if (argTransferBuild!="" && TransferMatrixCache(argTransferBuild, argEmOption, argCut).Has(exampleMaterialLayers)) {
+    G4cout << "Transfer matrix already in " << argTransferBuild << G4endl;
+    return 0;
+  }
+
+  bool importanceBiasing = HasImportances(exampleMaterialLayers) && !noBiasing;
+  configuration->SetImportanceBiasing(importanceBiasing);
+  configuration->SetParticleConversions(importanceBiasing || particleConversions);
+  // the scores are per event, split photon copies would need one each
+  if (sensitivity && importanceBiasing) G4cout << "Sensitivity scores need --no-biasing, ignored" << G4endl;
+  configuration->SetSensitivity(sensitivity && !importanceBiasing);
+
+  // seeded batch runs are reused from the result cache, --force reruns them
+  bool cacheable = argResultCache!="none" && argSeed>=0 && headless && argServe=="" && argReplayEvent==""
+    && argAnalytic=="" && argTransferBuild=="" && argResponseBuild=="" && argSlowEvents==0 && argColumns=="" && argStatusFile==""
+    && (argOut!="" || argSummary!="");
+  ResultCache resultCache(argResultCache);
+  G4String cacheDescription = "";
+  if (cacheable) {
+    cacheDescription = ResultCache::Describe(exampleMaterialLayers, argEmOption, argCut, argRun, argSeed);
+    if (!forceRun && resultCache.Fetch(cacheDescription, argOut, argSummary)) {
+      G4cout << "Run " << ResultCache::GetKey(cacheDescription) << " found in " << argResultCache << ", not simulated" << G4endl;
+      return 0;
+    }
   }
 
   if (!headless) ui = new G4UIExecutive(argc, argv);
   // Choose the Random engine
   G4Random::setTheEngine(new CLHEP::RanecuEngine);
+  if (argSeed>=0) G4Random::setTheSeed(argSeed);
   
   // Construct the default run manager
   //
@@ -90,63 +276,68 @@ int main(int argc,char** argv)
   //
   // Detector construction
 
-  std::vector<std::pair<G4String, G4double>> exampleMaterialLayers;
-  if (string("custom")==argGeometry) {
-    exampleMaterialLayers.push_back(std::make_pair(G4String("vacuum"),G4double(1.5)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("copper"),G4double(35e-3)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("vacuum"),G4double(1.0)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("fr4"),G4double(3)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("copper"),G4double(35e-2)));
-  } else if (string("custom10x10")==argGeometry) {
-    exampleMaterialLayers.push_back(std::make_pair(G4String("vacuum"),G4double(500)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("copper"),G4double(35e-3)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("fr4"),G4double(3.0)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("copper"),G4double(35e-3)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("vacuum"),G4double(1.5)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("kapton"),G4double(125e-3)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("vacuum"),G4double(3.0)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("kapton"),G4double(5e-3)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("copper"),G4double(5e-3)));
-  } else if (string("10x10")==argGeometry) {
-    exampleMaterialLayers.push_back(std::make_pair(G4String("vacuum"),G4double(1.5)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("kapton"),G4double(125e-3)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("vacuum"),G4double(3.0)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("kapton"),G4double(5e-3)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("copper"),G4double(5e-3)));
-  }
-  else if (string("ME0")==argGeometry) {
-    exampleMaterialLayers.push_back(std::make_pair(G4String("vacuum"),G4double(1.5)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("copper"),G4double(35e-3)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("fr4"),G4double(3.0)));
-    exampleMaterialLayers.push_back(std::make_pair(G4String("copper"),G4double(35e-3)));
-  }
-  runManager->SetUserInitialization(new DetectorConstructionBox(exampleMaterialLayers));
+  runManager->SetUserInitialization(new DetectorConstructionBox(exampleMaterialLayers, importanceBiasing));
 
   // Physics list
-  G4VModularPhysicsList* physicsList = new PhysicsList(); //new QBBC;
+  if (argPhysicsTables=="none") argPhysicsTables = "";
+  G4VModularPhysicsList* physicsList = new PhysicsList(exampleMaterialLayers, argEmOption, argCut*mm, argPhysicsTables, importanceBiasing); //new QBBC;
   physicsList->SetVerboseLevel(1);
   runManager->SetUserInitialization(physicsList);
     
   // User action initialization
-  runManager->SetUserInitialization(new ActionInitialization(headless, argOut, argSource, exampleMaterialLayers));
+  runManager->SetUserInitialization(new ActionInitialization(headless, exampleMaterialLayers));
   
-  // Initialize visualization
+  // Initialize visualization, only needed by interactive sessions
   //
-  G4VisManager* visManager = new G4VisExecutive;
-  // G4VisExecutive can take a verbosity argument - see /vis/verbose guidance.
-  // G4VisManager* visManager = new G4VisExecutive("Quiet");
-  visManager->Initialize();
+  G4VisManager* visManager = 0;
+  if (ui) {
+    StartupProfile::Scope profileScope("visualization");
+    visManager = new G4VisExecutive;
+    // G4VisExecutive can take a verbosity argument - see /vis/verbose guidance.
+    // G4VisManager* visManager = new G4VisExecutive("Quiet");
+    visManager->Initialize();
+  }
 
   // Get the pointer to the User Interface manager
   G4UImanager* UImanager = G4UImanager::GetUIpointer();
 
   // Process macro or start UI session
   //
-  if ( ! ui ) { 
+  if (argServe!="") {
+    // server mode
+    UImanager->ApplyCommand(G4String("/control/execute ")+argRun);
+    JobServer jobServer(argServe);
+    jobServer.Serve();
+  }
+  else if (argResponseBuild!="") {
+    runManager->Initialize();
+    BuildDetectorResponse(argResponseBuild, argResponseBins, argResponseMin, argResponseMax, argTransferEvents);
+  }
+  else if (argTransferBuild!="") {
+    runManager->Initialize();
+    TransferMatrixCache(argTransferBuild, argEmOption, argCut).Build(exampleMaterialLayers, argTransferEvents);
+  }
+  else if (argReplayEvent!="") {
+    // one worker, so that a profiler sees the event on one thread
+#ifdef G4MULTITHREADED
+    runManager->SetNumberOfThreads(1);
+#endif
+    runManager->Initialize();
+    runManager->BeamOn(argReplayRepeat);
+  }
+  else if (argAnalytic!="") {
+    // no Monte Carlo, the empty run builds the cross section tables
+    runManager->Initialize();
+    runManager->BeamOn(0);
+    RunAction *runAction = (RunAction *)runManager->GetUserRunAction();
+    runAction->WriteAnalyticSpectra(argAnalytic);
+  }
+  else if ( ! ui ) { 
     // batch mode
     G4String command = "/control/execute ";
     G4String fileName = argRun;
     UImanager->ApplyCommand(command+fileName);
+    if (cacheable) resultCache.Store(cacheDescription, argOut, argSummary);
   }
   else { 
     // interactive mode
@@ -33,6 +33,8 @@
 #include "G4VUserActionInitialization.hh"
 #include "G4String.hh"
 
+#include "LayerDescription.hh"
+
 #include <string>
 #include <vector>
 
@@ -43,7 +45,7 @@ using std::string;
 class ActionInitialization : public G4VUserActionInitialization
 {
 public:
-  ActionInitialization(bool headless, string outFilePath, string source, std::vector<std::pair<G4String, G4double>> layersMap);
+  ActionInitialization(bool headless, LayerStack layersMap);
   virtual ~ActionInitialization();
 
   virtual void BuildForMaster() const;
@@ -51,9 +53,7 @@ public:
 
 private:
   bool fHeadless;
-  string fOutFilePath;
-  string fSource;
-  std::vector<std::pair<G4String, G4double>> fLayersMap;
+  LayerStack fLayersMap;
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
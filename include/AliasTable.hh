@@ -0,0 +1,34 @@
+/// \file AliasTable.hh
+/// \brief Definition of the AliasTable class
+
+#ifndef AliasTable_h
+#define AliasTable_h 1
+
+#include <vector>
+
+/// Walker alias table of a discrete distribution (Vose's construction):
+/// an index is drawn in constant time from a single uniform number,
+/// whatever the number of entries.
+
+class AliasTable
+{
+public:
+  AliasTable(const std::vector<double> &weights = std::vector<double>());
+
+  // random strictly between 0 and 1; its integer part in units of
+  // 1/GetSize() picks a column, the fraction decides against the alias
+  int Sample(double random) const;
+
+  int GetSize() const { return fProbabilities.size(); }
+  // normalised probability of an index
+  double GetProbability(int index) const { return fWeights[index]; }
+
+private:
+  std::vector<double> fProbabilities; // of keeping the column, else its alias
+  std::vector<int> fAliases;
+  std::vector<double> fWeights;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
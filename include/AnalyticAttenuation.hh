@@ -0,0 +1,48 @@
+/// \file AnalyticAttenuation.hh
+/// \brief Definition of the AnalyticAttenuation class
+
+#ifndef AnalyticAttenuation_h
+#define AnalyticAttenuation_h 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include "AttenuationTable.hh"
+#include "LayerDescription.hh"
+
+#include <map>
+#include <vector>
+
+/// Uncollided photon spectra after each layer of the stack,
+/// exp(-sum mu x/cos(theta)) applied to the source spectrum and averaged
+/// over the emission cone, with mu from the physics list cross sections.
+///
+/// The spectra use the branch names and binning of the RunAction
+/// histograms, so that the difference to Monte Carlo is the scattered
+/// and fluorescence part. Vacuum layers are air, as in the geometry.
+/// Must be built after the physics tables.
+
+class AnalyticAttenuation
+{
+public:
+  AnalyticAttenuation(LayerStack layers);
+  virtual ~AnalyticAttenuation();
+
+  // energies in keV, probabilities normalised to one; cos(theta) uniform
+  // in [minCosTheta, 1]; contents per nEvents source photons
+  std::map<G4String, std::vector<G4double>> Compute(const std::vector<G4double> &energies,
+                                                   const std::vector<G4double> &probabilities,
+                                                   G4double minCosTheta, G4double nEvents,
+                                                   G4int nBins, G4double minEnergy, G4double maxEnergy) const;
+
+private:
+  std::vector<G4String> fBranchNames; // per layer, empty for vacuum
+  std::vector<G4double> fThicknesses;
+  std::vector<AttenuationTable *> fTables;
+
+  const G4int fDirections = 32;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
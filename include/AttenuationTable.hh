@@ -0,0 +1,38 @@
+/// \file AttenuationTable.hh
+/// \brief Definition of the AttenuationTable class
+
+#ifndef AttenuationTable_h
+#define AttenuationTable_h 1
+
+#include "G4String.hh"
+#include "globals.hh"
+#include "CLHEP/Units/SystemOfUnits.h"
+
+#include <vector>
+
+class G4Material;
+
+/// Linear attenuation coefficient of photons in one material, summed over
+/// the given gamma processes and tabulated on a logarithmic energy grid
+/// from the cross sections of the physics list (G4EmCalculator).
+///
+/// Must be built after the physics tables, i.e. from a run or event action.
+
+class AttenuationTable
+{
+public:
+  AttenuationTable(const G4Material *material,
+                   std::vector<G4String> processes = {"phot", "compt", "Rayl"},
+                   G4double minEnergy = 1*CLHEP::keV, G4double maxEnergy = 100*CLHEP::keV, G4int nBins = 400);
+
+  // attenuation coefficient in Geant4 units (1/length), log-log interpolated
+  G4double GetAttenuation(G4double energy) const;
+
+private:
+  std::vector<G4double> fLogEnergies;
+  std::vector<G4double> fLogAttenuations;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,58 @@
+/// \file ColumnWriter.hh
+/// \brief Definition of the ColumnWriter class
+
+#ifndef ColumnWriter_h
+#define ColumnWriter_h 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include <cstdint>
+#include <fstream>
+#include <initializer_list>
+#include <vector>
+
+/// Rows of one output tree written as raw columns, one file per column,
+/// next to or instead of the ROOT trees: analysis maps them as arrays
+/// (numpy.memmap, see analysis.py) without parsing or copying.
+///
+/// File layout, little-endian: "GEMCOLS1", header size (uint32, 64),
+/// value size (uint32, 8), number of rows (uint64), column name (32
+/// chars, zero padded), 8 reserved bytes, then the float64 values.
+/// The rows are streamed through a small buffer during the run and the
+/// count is written on Close(); a file left by a crashed run still holds
+/// (size-64)/8 valid values.
+///
+/// Files are <directory>/<tree>.<column>.col, with a .t<thread> suffix
+/// before .col for the worker threads of an MT run.
+
+class ColumnWriter
+{
+public:
+  ColumnWriter(G4String directory, G4String tree, const std::vector<G4String> &columns, G4int thread);
+  virtual ~ColumnWriter();
+
+  // one value per column, in the order given to the constructor
+  void Fill(std::initializer_list<G4double> values) {
+    for (G4double value:values) fBuffer.push_back(value);
+    if (fBuffer.size()>=kBufferRows*fFiles.size()) WriteBuffer();
+  }
+
+  void Close();
+
+  static const size_t kHeaderSize = 64;
+
+private:
+  void WriteBuffer();
+
+  static const size_t kBufferRows = 4096;
+
+  std::vector<std::ofstream*> fFiles;
+  std::vector<G4double> fBuffer; // interleaved rows
+  std::vector<G4double> fColumn;
+  uint64_t fRows = 0;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
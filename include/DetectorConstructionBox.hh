@@ -36,6 +36,8 @@
 #include "G4Colour.hh"
 #include "globals.hh"
 
+#include "LayerDescription.hh"
+
 class G4VPhysicalVolume;
 class G4LogicalVolume;
 
@@ -44,10 +46,12 @@ class G4LogicalVolume;
 class DetectorConstructionBox : public G4VUserDetectorConstruction
 {
 public:
-  DetectorConstructionBox(std::vector<std::pair<G4String, G4double>>);
+  DetectorConstructionBox(LayerStack, G4bool importanceBiasing = false);
   virtual ~DetectorConstructionBox();
 
   virtual G4VPhysicalVolume* Construct();
+  // fills the importance store of the thread when biasing
+  virtual void ConstructSDandField();
 
   void ConstructMaterials();
     
@@ -58,7 +62,8 @@ public:
   G4Material *createFR4();  
 
 protected:
-  std::vector<std::pair<G4String, G4double>> materialLayers;
+  LayerStack materialLayers;
+  G4bool fImportanceBiasing;
   std::map<G4String, G4Material *> materialMap;
   std::map<G4String, G4Colour> colorMap;
   //G4LogicalVolume *fCopperLogical;
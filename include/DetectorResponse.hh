@@ -0,0 +1,27 @@
+/// \file DetectorResponse.hh
+/// \brief Definition of the DetectorResponse functions
+
+#ifndef DetectorResponse_h
+#define DetectorResponse_h 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+/// Response of the full chain (layer stack, gas gap and HEED) as a
+/// ResponseMatrix from photon energy (keV) to conversion primaries, per
+/// source photon, built by a monoenergetic scan of the configured
+/// geometry. The scan draws directions in the cone of the configured
+/// source, as the path length in every layer depends on the angle; the
+/// cone is written in the description and checked when folding. A
+/// phasespace source is scanned uniformly up to its largest angle.
+
+// nBins incident energies between minEnergy and maxEnergy (keV), at the
+// bin centres; the kernel must be initialised
+void BuildDetectorResponse(G4String path, G4int nBins, G4double minEnergy, G4double maxEnergy, G4int eventsPerEnergy);
+
+// primaries spectrum of a source through a response matrix, no Geant4 needed
+void FoldDetectorResponse(G4String responsePath, G4String source, G4String spectrumPath, G4String outPath);
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
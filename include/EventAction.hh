@@ -35,16 +35,20 @@
 #include "G4UserEventAction.hh"
 #include "globals.hh"
 
+#include "LayerDescription.hh"
 #include "RunAction.hh"
 
 #include <TH1F.h>
 
 #include <vector>
 #include <map>
+#include <chrono>
 
 using namespace std;
 
 class RunAction;
+class G4Track;
+class G4ParticleDefinition;
 
 /// Event action class
 ///
@@ -53,6 +57,15 @@ struct particle { // needed to interface with HEED
   G4double energy;
   G4ThreeVector position;
   G4ThreeVector momentum;
+  G4double weight; // track weight, one without importance biasing
+};
+
+struct primaryRecord { // what an event keeps of each of its primary photons
+  map<G4String,G4DataVector> hitEnergies;
+  map<G4String,G4DataVector> hitWeights;
+  vector<particle> photons;
+  vector<particle> electrons;
+  map<G4String,G4double> sensitivityScores;
 };
 
 class EventAction : public G4UserEventAction
@@ -64,29 +77,64 @@ public:
   virtual void BeginOfEventAction(const G4Event* event);
   virtual void EndOfEventAction(const G4Event* event);
 
-  void AddHit(G4String volume, G4double energy);
-  void AddPhoton(G4double energy, G4ThreeVector position, G4ThreeVector momentum);
-  void AddElectron(G4double energy, G4ThreeVector position, G4ThreeVector momentum);
+  // primary photon, from 0 to the photons per event minus one, that a
+  // track descends from: registered at the first step of the track
+  G4int RegisterTrack(G4int trackID, G4int parentID);
+  G4int GetTrackPrimary(G4int trackID) const { return fTrackPrimaries[trackID]; }
+
+  // hits and gas particles are kept apart for every primary photon
+  void AddHit(G4String volume, G4double energy, G4double weight = 1., G4int primary = 0);
+  void AddPhoton(G4double energy, G4ThreeVector position, G4ThreeVector momentum, G4double weight = 1., G4int primary = 0);
+  void AddElectron(G4double energy, G4ThreeVector position, G4ThreeVector momentum, G4double weight = 1., G4int primary = 0);
+  // contribution of a photon step to the density derivative score of a layer
+  void AddSensitivityScore(G4String volume, G4double score, G4int primary = 0) { fPrimaryRecords[primary].sensitivityScores[volume] += score; }
   int TransportPhotons();
   int TransportElectrons();
-
-  std::vector<std::pair<G4String, G4double>> fLayersMap;
+  // conversion entries with every gas photon forced to convert, see RunConfiguration
+  void FillForcedConversions();
+  // one conversion entry per gas particle with its track weight, used with
+  // importance biasing: split copies of a photon must not be added together.
+  // This is a different estimator from the per-photon sum of the analog
+  // run, whenever a photon brings several particles into the gas (e.g. an
+  // electron and a fluorescence photon); compare with an analog run using
+  // the same filling, --particle-conversions
+  void FillParticleConversions();
+
+  // wall time and content of the event for the slow event list, from the
+  // primary generation (which saves the engine state) to the end of event
+  void StartSlowEventClock(const G4String &engineState);
+  void CountStep(const G4Track *track);
+
+  RunAction *GetRunAction() const { return runAction; }
+
+  LayerStack fLayersMap;
   
 private:
   RunAction* runAction;
 
 
-  map<string,G4DataVector*> hitEnergies;
   map<string,vector<G4ThreeVector>*> hitPositions;
   map<string,vector<G4ThreeVector>*> hitMomenta;
+
+  vector<primaryRecord> fPrimaryRecords;
+  vector<G4int> fTrackPrimaries; // indexed by track ID
+
+  // slow event bookkeeping, only with --slow-events
+  G4bool fRecordSlowEvents = false;
+  std::chrono::steady_clock::time_point fEventStart;
+  G4String fEngineState;
+  G4long fEventSteps = 0;
+  map<const G4ParticleDefinition*, G4int> fEventTracks;
   
   std::vector<G4String> volumeBranchNames;
   G4String volumes[3] = {"window", "driftKapton", "driftCopper"};
 
+  // gas particles of the primary photon being converted
   vector<particle> *electrons;
   vector<particle> *photons;
   
   double gasIonizationEnergy = 31.2; // from previous HEED simulation
+  const int maxForcedPhotons = 12;
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,29 @@
+/// \file ExceptionHandler.hh
+/// \brief Definition of the ExceptionHandler class
+
+#ifndef ExceptionHandler_h
+#define ExceptionHandler_h 1
+
+#include "G4ExceptionHandler.hh"
+#include "globals.hh"
+
+/// The Geant4 exception handler, writing out the Logger first. A fatal
+/// exception aborts the process, and the messages still in the thread
+/// buffers, usually the ones explaining it, would be lost otherwise.
+///
+/// G4StateManager keeps one handler per thread: ActionInitialization
+/// installs one on the master and on every worker.
+
+class ExceptionHandler : public G4ExceptionHandler
+{
+public:
+  ExceptionHandler() {}
+  virtual ~ExceptionHandler() {}
+
+  virtual G4bool Notify(const char* originOfException, const char* exceptionCode,
+      G4ExceptionSeverity severity, const char* description);
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
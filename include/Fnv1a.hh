@@ -0,0 +1,31 @@
+/// \file Fnv1a.hh
+/// \brief 64-bit FNV-1a hash used for the cache keys and the HEED seeds
+
+#ifndef Fnv1a_h
+#define Fnv1a_h 1
+
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+// hash of a text description
+inline unsigned long long Fnv1a(const std::string &description) {
+  unsigned long long hash = 14695981039346656037ULL;
+  for (char c:description) {
+    hash ^= (unsigned char)c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// the same, as 16 hexadecimal digits
+inline std::string Fnv1aHex(const std::string &description) {
+  unsigned long long hash = Fnv1a(description);
+  std::ostringstream key;
+  key << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return key.str();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -10,6 +10,8 @@
 #include "EventAction.hh"
 #include "RunAction.hh"
 
+#include "AttenuationTable.hh"
+
 #include "Garfield/TrackHeed.hh"
 
 using namespace Garfield;
@@ -25,10 +27,28 @@ public:
   
   int TransportPhoton(EventAction *eventAction, G4double energy, G4ThreeVector position, G4ThreeVector momentum);
   int TransportElectron(EventAction *eventAction, G4double energy, G4ThreeVector position, G4ThreeVector momentum);
+  // transports the photon until it converts in the gas, at most
+  // maxForcedTrials times; probability is the analog conversion
+  // probability along the path, conversionWeight that of the conversion
+  // returned: probability over the chance of converting within the
+  // trials, zero if none converted
+  int ForcePhotonConversion(EventAction *eventAction, G4double energy, G4ThreeVector position, G4ThreeVector momentum,
+      G4double &probability, G4double &conversionWeight);
+  // HEED draws from the Garfield engine, not from Geant4's; seeding it
+  // from the event makes the whole event follow from the Geant4 state,
+  // as long as no other worker draws from the engine, which is global
+  void SeedRandom(unsigned int seed);
 
 private:
   RunAction *runAction;
   TrackHeed *track;
+  bool tracked = false;
+  AttenuationTable *gasAttenuation = 0; // built at the first forced conversion
+  // gas gap sides in cm
+  const double length = 10;
+  const double width = 10;
+  const double depth = 0.3;
+  const int maxForcedTrials = 100; // bounds the HEED transports per photon
   double gasIonizationEnergy = 31.2; // from previous HEED simulation
 };
 
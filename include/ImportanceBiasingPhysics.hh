@@ -0,0 +1,36 @@
+/// \file ImportanceBiasingPhysics.hh
+/// \brief Definition of the ImportanceBiasingPhysics class
+
+#ifndef ImportanceBiasingPhysics_h
+#define ImportanceBiasingPhysics_h 1
+
+#include "G4VPhysicsConstructor.hh"
+#include "G4String.hh"
+#include "globals.hh"
+
+class G4GeometrySampler;
+
+/// Geometry importance sampling (splitting and Russian roulette at volume
+/// boundaries) of one particle type in the mass geometry.
+///
+/// Unlike G4ImportanceBiasing, the sampler is created in ConstructProcess,
+/// when the world volume exists, once per thread. The importance values
+/// are filled in DetectorConstructionBox::ConstructSDandField().
+
+class ImportanceBiasingPhysics : public G4VPhysicsConstructor
+{
+public:
+  ImportanceBiasingPhysics(G4String particleName = "gamma");
+  virtual ~ImportanceBiasingPhysics();
+
+  virtual void ConstructParticle() {}
+  virtual void ConstructProcess();
+
+private:
+  G4String fParticleName;
+  static G4ThreadLocal G4GeometrySampler *fSampler;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,53 @@
+/// \file JobServer.hh
+/// \brief Definition of the JobServer class
+
+#ifndef JobServer_h
+#define JobServer_h 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include <ostream>
+#include <string>
+
+/// Keeps an initialized run manager warm and runs simulation jobs
+/// received over a Unix domain socket.
+///
+/// A job is one line of whitespace-separated key=value pairs, e.g.
+///   source=fe55 events=100000 out=fe55.root seed=1234
+/// Known keys are source, spectrum, spot, kv, events (required), out, seed,
+/// forced (1 or 0, forced gas conversion), qmc (1 or 0, quasi-random
+/// primaries) and photons (primary photons per event).
+/// The reply starts with "ok" or "error", followed by the merged
+/// histograms of the run (see RunAction::WriteHistograms) and "end".
+/// Jobs with an unreadable or empty source are rejected with "error"
+/// before the run, so that they cannot stop the server.
+/// The line "quit" stops the server.
+/// Connections are served one at a time: a request must arrive within
+/// kTimeoutSeconds and kMaxRequestSize bytes, and a reply that cannot be
+/// sent for as long is abandoned.
+
+class JobServer
+{
+public:
+  JobServer(G4String socketPath);
+  virtual ~JobServer();
+
+  void Serve();
+
+private:
+  static const G4int kTimeoutSeconds = 5;
+  static const size_t kMaxRequestSize = 4096;
+
+  // the first line received, without the newline; an error message if
+  // it is too long or does not arrive in time
+  G4String ReadRequest(G4int connection, std::string &request);
+  G4bool RunJob(G4String request, std::ostream &reply);
+
+  G4String fSocketPath;
+  G4int fSocket;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
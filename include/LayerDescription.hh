@@ -0,0 +1,50 @@
+/// \file LayerDescription.hh
+/// \brief Definition of the LayerDescription struct and layer stack helpers
+
+#ifndef LayerDescription_h
+#define LayerDescription_h 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include <vector>
+
+/// One layer of the stack in front of the gas gap.
+///
+/// Besides material and thickness, every layer carries the EM settings
+/// of its region: production cut, atomic deexcitation and msc model,
+/// and its photon importance for geometry biasing.
+/// Vacuum layers are empty space and have no region; with importance
+/// biasing they are placed as air volumes to carry their importance.
+
+struct LayerDescription {
+  G4String material;
+  G4double thickness; // mm
+
+  G4double cut = -1.; // production cut in mm, negative for the default cuts
+  G4bool fluo = false;
+  G4bool auger = false;
+  G4bool pixe = false;
+  G4String msc = ""; // urban or gs, empty for the physics list default
+  G4double importance = 1.; // photons are split or rouletted by the importance ratio at the boundaries
+};
+
+typedef std::vector<LayerDescription> LayerStack;
+
+// stacks used so far: 10x10, ME0, custom and custom10x10
+LayerStack GetLayerPreset(G4String geometry);
+
+// one layer per line, "material thickness_mm [key=value ...]",
+// keys cut, fluo, auger, pixe, msc and importance, # starts a comment
+LayerStack ReadLayerFile(G4String path);
+
+// true if any layer has an importance other than one
+G4bool HasImportances(const LayerStack &layers);
+
+// name of the G4Region of a non-vacuum layer, index counted as in the
+// volume names (vacuum layers skipped, starting from 1)
+G4String GetLayerRegionName(const LayerDescription &layer, G4int materialIndex);
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,128 @@
+/// \file Logger.hh
+/// \brief Definition of the Logger class
+
+#ifndef Logger_h
+#define Logger_h 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+/// Messages of the simulation threads, written without going through
+/// G4cout, which serialises the workers on the master's output.
+///
+/// Every thread appends to a ring buffer of its own, a single-producer
+/// single-consumer queue without locks; a background thread drains all of
+/// them every few milliseconds in time order. A full buffer drops the
+/// message and counts it, so a hot path never waits for the output.
+/// Each call site logs its first 10 messages, then only the 100th, 1000th,
+/// 10000th... with the number of repetitions. LOG_PROGRESS is never rate
+/// limited, for messages whose frequency the caller already controls.
+///
+///   LOG_WARNING("Unexpected " << particleName << " in the gas");
+
+#define GEMXRAY_LOG(severity, message) \
+  do { \
+    Logger *logger = Logger::Instance(); \
+    if (logger->IsEnabled(severity)) { \
+      static Logger::Site logSite; \
+      G4long logRepeated = logger->Admit(logSite); \
+      if (logRepeated>0) { \
+        std::ostringstream logStream; \
+        logStream << message; \
+        logger->Write(severity, logStream.str(), logRepeated); \
+      } \
+    } \
+  } while (0)
+
+// every message, for call sites that limit themselves
+#define GEMXRAY_LOG_ALL(severity, message) \
+  do { \
+    Logger *logger = Logger::Instance(); \
+    if (logger->IsEnabled(severity)) { \
+      std::ostringstream logStream; \
+      logStream << message; \
+      logger->Write(severity, logStream.str()); \
+    } \
+  } while (0)
+
+#define LOG_DEBUG(message) GEMXRAY_LOG(Logger::kDebug, message)
+#define LOG_INFO(message) GEMXRAY_LOG(Logger::kInfo, message)
+#define LOG_WARNING(message) GEMXRAY_LOG(Logger::kWarning, message)
+#define LOG_ERROR(message) GEMXRAY_LOG(Logger::kError, message)
+#define LOG_PROGRESS(message) GEMXRAY_LOG_ALL(Logger::kInfo, message)
+
+class Logger
+{
+public:
+  enum Severity { kDebug, kInfo, kWarning, kError };
+
+  static Logger* Instance();
+  ~Logger();
+
+  // messages below the level are discarded where they are logged
+  void SetLevel(Severity level) { fLevel = level; }
+  G4bool IsEnabled(Severity severity) const { return severity>=fLevel.load(std::memory_order_relaxed); }
+  // debug, info, warning or error; false if unknown
+  G4bool SetLevel(G4String levelName);
+
+  /// Occurrences of one logging statement, shared by all threads
+  struct Site {
+    std::atomic<G4long> count{0};
+  };
+  // zero if the message is rate limited, else its occurrence number
+  G4long Admit(Site &site);
+
+  void Write(Severity severity, const std::string &text, G4long occurrence = 1);
+
+  // writes out everything logged so far, before output of the caller
+  void Flush();
+
+private:
+  Logger();
+
+  static const size_t kTextSize = 240;
+  static const size_t kCapacity = 1024; // records per thread
+  static const G4long kBurst = 10; // messages of a site before rate limiting
+
+  struct Record {
+    int64_t time; // steady clock nanoseconds
+    G4int severity;
+    G4long occurrence;
+    char text[kTextSize];
+  };
+
+  struct Buffer {
+    std::atomic<uint64_t> head{0}; // advanced by the logging thread
+    std::atomic<uint64_t> tail{0}; // advanced by the flusher
+    std::atomic<uint64_t> dropped{0};
+    G4int thread;
+    Record records[kCapacity];
+  };
+
+  Buffer *GetThreadBuffer();
+  void Loop();
+
+  std::atomic<G4int> fLevel{kInfo};
+
+  std::mutex fBuffersMutex; // registration of the thread buffers
+  std::vector<std::unique_ptr<Buffer>> fBuffers;
+
+  std::mutex fDrainMutex; // one drain at a time, never taken by a logging thread
+  std::thread fFlusher;
+  std::mutex fStopMutex;
+  std::condition_variable fStopCondition;
+  G4bool fStopping = false;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
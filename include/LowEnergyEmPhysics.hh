@@ -0,0 +1,32 @@
+/// \file LowEnergyEmPhysics.hh
+/// \brief Definition of the LowEnergyEmPhysics class
+
+#ifndef LowEnergyEmPhysics_h
+#define LowEnergyEmPhysics_h 1
+
+#include "G4VPhysicsConstructor.hh"
+#include "G4String.hh"
+#include "globals.hh"
+
+/// EM physics for the 1-60 keV X-ray problem: gamma, e- and e+ only,
+/// with Livermore or Penelope low-energy models and atomic deexcitation.
+/// No decay or hadronic processes are registered.
+
+class LowEnergyEmPhysics : public G4VPhysicsConstructor
+{
+public:
+  LowEnergyEmPhysics(G4String modelSet = "livermore"); // livermore or penelope
+  virtual ~LowEnergyEmPhysics();
+
+  virtual void ConstructParticle();
+  virtual void ConstructProcess();
+
+  G4String GetModelSet() const { return fModelSet; }
+
+private:
+  G4String fModelSet;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,43 @@
+/// \file PhaseSpaceTable.hh
+/// \brief Definition of the PhaseSpaceTable class
+
+#ifndef PhaseSpaceTable_h
+#define PhaseSpaceTable_h 1
+
+#include "AliasTable.hh"
+
+#include <string>
+#include <vector>
+
+/// Two-dimensional distribution tabulated on a grid, e.g. photon energy
+/// against polar angle, or a focal-spot image.
+///
+/// The file has one "x y w" line per grid point (commas or spaces, "#"
+/// for comments); missing points have no weight. Points are cell centres,
+/// the cell edges lie half way between neighbouring points. A cell is
+/// drawn from an alias table and the point is uniform within the cell, so
+/// sampling costs the same at any table resolution.
+
+class PhaseSpaceTable
+{
+public:
+  bool Read(const std::string &path);
+
+  // three uniform numbers, strictly between 0 and 1
+  void Sample(double cellRandom, double xRandom, double yRandom, double &x, double &y) const;
+
+  // cell centres and the probability of each along one axis
+  void GetMarginalX(std::vector<double> &centres, std::vector<double> &probabilities) const;
+  double GetYMin() const { return fYEdges.front(); }
+  double GetYMax() const { return fYEdges.back(); }
+
+private:
+  static std::vector<double> GetEdges(const std::vector<double> &centres);
+
+  std::vector<double> fXCentres, fXEdges, fYEdges; // the cell of (ix, iy) is ix*nY+iy
+  AliasTable fCells;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -1,14 +1,31 @@
-#include "QBBC.hh"
+#ifndef PhysicsList_h
+#define PhysicsList_h 1
+
+#include "G4VModularPhysicsList.hh"
+#include "G4String.hh"
 #include "globals.hh"
 
+#include "LayerDescription.hh"
+
 class PhysicsList : public G4VModularPhysicsList
 {
 public:
 
-  explicit PhysicsList();
+  // emOption: livermore, penelope or option4 (G4EmStandardPhysics_option4)
+  // defaultCut: production cut outside the layers with their own, all particles;
+  // <=0 for the Geant4 default with a 0.1 mm gamma cut
+  // tableDirectory: where physics tables are stored and retrieved,
+  // empty to always build them
+  // importanceBiasing: photon importance sampling with the layer importances
+  explicit PhysicsList(LayerStack layers, G4String emOption = "livermore", G4double defaultCut = -1., G4String tableDirectory = "", G4bool importanceBiasing = false);
   virtual ~PhysicsList();
 
-  void ConstructProcess();
+  virtual void ConstructProcess();
+  virtual void SetCuts();
+
+  // store the tables built for this material and cut set,
+  // called once they exist, i.e. at the beginning of the first run
+  void StoreTables();
   
 private:
 
@@ -16,6 +33,15 @@ private:
   PhysicsList(PhysicsList &);
   PhysicsList & operator=(const PhysicsList &right);
 
+  G4String TableKey() const;
+
   G4VPhysicsConstructor *emPhysicsList;
+  LayerStack fLayers;
+  G4String fEmOption;
+
+  G4String fTableDirectory;
+  G4String fTableKey;
+  G4bool fTablesStored = false;
 };
 
+#endif
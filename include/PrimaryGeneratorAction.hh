@@ -33,24 +33,49 @@
 #include "G4VUserPrimaryGeneratorAction.hh"
 #include "G4ParticleGun.hh"
 #include "G4String.hh"
+#include "G4ThreeVector.hh"
 #include "globals.hh"
 
 #include "RunAction.hh"
+#include "AliasTable.hh"
+#include "SpectrumLibrary.hh"
+
+#include <vector>
 
 class G4ParticleGun;
 class EventAction;
 class G4Event;
 class G4Box;
+class SobolSequence;
+class PhaseSpaceTable;
+struct SlowEvent;
 
 /// The primary generator action class with particle gun.
 ///
-/// The default kinematic is a 6 MeV gamma, randomly distribued 
-/// in front of the phantom across 80% of the (X,Y) phantom size.
+/// The source is resolved once per run from its SourceDescription: the
+/// energies go into one AliasTable, and the photon and direction
+/// samplers are chosen as member function pointers, so that generating
+/// a photon compares no strings and costs the same for any number of
+/// lines or spectrum points.
+///
+/// A phasespace source draws energy (keV) and polar angle (degrees)
+/// together from a PhaseSpaceTable, with a uniform azimuth; negative
+/// angles are mirrored through the axis. The weights are cell
+/// probabilities, not densities per solid angle.
+/// A library source takes the tube spectrum at the configured voltage
+/// from a memory-mapped SpectrumLibrary, and samples its quantile
+/// function with one uniform number.
+/// Any source may start from a focal-spot image instead of a point.
+///
+/// With --slow-events the engine state is saved before the event draws
+/// anything, and HEED is seeded from a hash of it without drawing from the
+/// engine; --replay-event restores a saved state instead, and the Sobol
+/// scrambling of the recorded run, so the replayed event is the recorded one.
 
 class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 {
 public:
-  PrimaryGeneratorAction(EventAction *eventAction, G4String source, bool headless);    
+  PrimaryGeneratorAction(EventAction *eventAction, bool headless);    
   virtual ~PrimaryGeneratorAction();
 
   // method from the base class
@@ -59,9 +84,37 @@ public:
   // method to access particle gun
   const G4ParticleGun* GetParticleGun() const { return fParticleGun; }
 
-  void ReadSpectrumData();
+  // pick up source and spectrum changes from RunConfiguration
+  void Configure();
+
+  // energies (keV) and probabilities of the source as sampled by
+  // GeneratePrimaries, also available where no generator exists (MT master)
+  static void GetSourceSpectrum(G4String source, G4String spectrumPath, std::vector<G4double> &energies, std::vector<G4double> &probabilities);
+  // cos(theta) of the primaries is uniform between this and one; for
+  // phasespace, the widest angle of the table, as an approximation
+  static G4double GetMinCosTheta(G4String source, G4String spectrumPath = "");
+  // why Configure() would fail with these settings, empty if it would not
+  static G4String CheckSource(G4String source, G4String spectrumPath, G4String spotPath, G4double tubeVoltage);
   
 private:
+  void GeneratePrimaryPhoton(G4Event*, G4double z0);
+  static PhaseSpaceTable *ReadPhaseSpaceTable(G4String path);
+  static std::vector<G4double> ReadLibraryQuantiles(SpectrumLibrary &library, G4String path, G4String filter, G4double voltage);
+
+  // photon energy (keV) and direction, one of each kind of source
+  void SampleLinePhoton(G4double &energy, G4ThreeVector &direction) const;
+  void SamplePhaseSpacePhoton(G4double &energy, G4ThreeVector &direction) const;
+  void SampleQuantilePhoton(G4double &energy, G4ThreeVector &direction) const;
+  void (PrimaryGeneratorAction::*fSamplePhoton)(G4double &, G4ThreeVector &) const = 0;
+
+  // direction of a line source
+  void SamplePencilDirection(G4ThreeVector &direction) const;
+  void SampleConeDirection(G4ThreeVector &direction) const;
+  void (PrimaryGeneratorAction::*fSampleDirection)(G4ThreeVector &) const = 0;
+
+  // coordinate of the photon's Sobol point, or a pseudo-random number
+  G4double GetUniform(G4int dimension) const;
+
   G4ParticleGun*        fParticleGun;
   G4Box*                fEnvelopeBox;
   G4Box*                fCopperBox;
@@ -69,19 +122,32 @@ private:
   RunAction* runAction;
 
   bool fHeadless;
+
+  // the source is read again only when one of these changes
   G4String fSource;
+  G4double fMonoEnergy;
+  G4double fMonoMinCosTheta = 1.;
+  G4String fSpectrumPath;
+  G4double fTubeVoltage;
+
+  std::vector<G4double> fEnergies;
+  AliasTable fEnergyTable;
+  G4double fMinCosTheta = 1.;
+
+  SpectrumLibrary fLibrary; // stays mapped across runs
+  G4String fLibraryPath;
+  std::vector<G4double> fQuantiles; // keV, at the configured voltage
 
-  G4DataVector *primaryEnergies;
-  G4DataVector *primarySpectrum;
-  G4double primarySpectrumSum;
+  G4int fPhotonsPerEvent = 1;
+  G4bool fRecordSlowEvents = false;
+  const SlowEvent *fReplayEvent = 0;
+  G4long fPointIndex = 0; // of the current photon, event ID times photons per event plus photon
 
-  G4double ironLineEnergies[2] = {5.89, 6.49};
-  G4double ironLineIntensities[2] = {0.87985866, 0.12014134};
+  SobolSequence *fSobolSequence = 0; // quasi-random mode only
 
-  //G4double cadmiumLineEnergies[3] = {3.1, 22.1, 25.0};
-  //G4double cadmiumLineIntensities[3] = {0.09256109569420821, 0.7483663056127473, 0.1590725986930445};
-  G4double cadmiumLineEnergies[2] = {22.1, 25.0};
-  G4double cadmiumLineIntensities[2] = {0.7483663056127473, 0.1590725986930445};
+  PhaseSpaceTable *fPhaseSpaceTable = 0;
+  PhaseSpaceTable *fSpotTable = 0;
+  G4String fSpotPath;
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,61 @@
+/// \file ResponseMatrix.hh
+/// \brief Definition of the ResponseMatrix class
+
+#ifndef ResponseMatrix_h
+#define ResponseMatrix_h 1
+
+#include <string>
+#include <vector>
+
+/// Linear map between two binned spectra: element (out, in) is the mean
+/// content of output bin out per entry in input bin in.
+///
+/// Plain C++, no Geant4, so that matrices can be composed and applied
+/// without initialising the simulation. Stored as text: a description
+/// line, the input and output binnings, then one row per output bin.
+/// In memory the columns are contiguous: applying the matrix is a sum of
+/// scaled columns, which the compiler vectorises without reordering any
+/// floating point reduction, and empty input bins are skipped.
+
+class ResponseMatrix
+{
+public:
+  ResponseMatrix(int nIn = 0, double inMin = 0., double inMax = 0., int nOut = 0, double outMin = 0., double outMax = 0.);
+
+  bool Read(const std::string &path);
+  bool Write(const std::string &path) const;
+
+  int GetNIn() const { return fNIn; }
+  int GetNOut() const { return fNOut; }
+  double GetInMin() const { return fInMin; }
+  double GetInMax() const { return fInMax; }
+  double GetOutMin() const { return fOutMin; }
+  double GetOutMax() const { return fOutMax; }
+  // bin centre of an input bin
+  double GetInCenter(int in) const { return fInMin+(in+0.5)*(fInMax-fInMin)/fNIn; }
+
+  const std::string &GetDescription() const { return fDescription; }
+  void SetDescription(const std::string &description) { fDescription = description; }
+
+  double &operator()(int out, int in) { return fElements[(size_t)in*fNOut+out]; }
+  double operator()(int out, int in) const { return fElements[(size_t)in*fNOut+out]; }
+  const double *GetColumn(int in) const { return &fElements[(size_t)in*fNOut]; }
+  void SetColumn(int in, const std::vector<double> &column);
+
+  // output spectrum of an input spectrum with GetNIn() bins
+  std::vector<double> Apply(const std::vector<double> &input) const;
+  // input spectrum binned as the matrix input, from energy lines
+  std::vector<double> Bin(const std::vector<double> &values, const std::vector<double> &weights) const;
+  // the matrix of this followed by next, whose input binning must match our output
+  ResponseMatrix Then(const ResponseMatrix &next) const;
+
+private:
+  int fNIn, fNOut;
+  double fInMin, fInMax, fOutMin, fOutMax;
+  std::string fDescription;
+  std::vector<double> fElements; // column-major, fNIn columns of fNOut
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
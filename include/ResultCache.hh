@@ -0,0 +1,50 @@
+/// \file ResultCache.hh
+/// \brief Definition of the ResultCache class
+
+#ifndef ResultCache_h
+#define ResultCache_h 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include "LayerDescription.hh"
+
+/// Directory of finished batch runs, one subdirectory per run key with
+/// the ROOT output, the JSON summary if one was written, and the text the
+/// key was hashed from.
+///
+/// The key is the FNV-1a hash of everything that determines the output
+/// of a seeded run: the layer stack, the physics options, the source
+/// settings of RunConfiguration with the contents of every file the
+/// source reads, the contents of the macro and of the macros it runs, the
+/// seed, the executable and its shared libraries (size and modification
+/// time), and the Geant4 data sets of the environment, so that a rebuild
+/// or another data version invalidates the cache.
+/// An entry is written to a temporary directory and renamed into place
+/// once complete. Summaries copied from the cache have "cached": true.
+
+class ResultCache
+{
+public:
+  ResultCache(G4String directory);
+
+  // description of a run, read from the configuration of the process
+  static G4String Describe(const LayerStack &layers, G4String emOption, G4double cut,
+      G4String macroPath, G4long seed);
+  static G4String GetKey(G4String description);
+
+  // copies the cached outputs to the given paths, empty paths are not
+  // needed; false if the entry is missing or lacks one of them
+  G4bool Fetch(G4String description, G4String outFilePath, G4String summaryPath) const;
+  // keeps the outputs of a finished run, replacing any previous entry
+  void Store(G4String description, G4String outFilePath, G4String summaryPath) const;
+
+private:
+  G4String GetEntryPath(G4String description) const;
+
+  G4String fDirectory;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
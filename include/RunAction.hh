@@ -32,8 +32,15 @@
 
 #include <TTree.h>
 #include <TH1F.h>
+#include <TH1D.h>
 
 #include "HeedSimulation.hh"
+#include "LayerDescription.hh"
+#include "AnalyticAttenuation.hh"
+#include "Instrumentation.hh"
+#include "SlowEventList.hh"
+#include "RunStatus.hh"
+#include "ColumnWriter.hh"
 
 #include "G4UserRunAction.hh"
 #include "G4Accumulable.hh"
@@ -43,6 +50,8 @@
 
 #include <vector>
 #include <map>
+#include <ostream>
+#include <chrono>
 
 using std::map;
 using std::vector;
@@ -53,16 +62,57 @@ class HeedSimulation;
 
 class RunAction:public G4UserRunAction {
 public:
-  RunAction(bool headless, string outFilePath, vector<std::pair<G4String, G4double>>);
+  RunAction(bool headless, LayerStack);
   virtual ~RunAction();
 
   // virtual G4Run* GenerateRun();
   virtual void BeginOfRunAction(const G4Run*);
   virtual void EndOfRunAction(const G4Run*);
 
-  void FillNtuples(G4String volume, G4double energy);
-  void FillNtuples(G4String volume, G4double energy, G4int primaries);
+  void FillNtuples(G4String volume, G4double energy, G4double weight = 1.);
+  void FillNtuples(G4String volume, G4double energy, G4int primaries, G4double weight = 1.);
   void FillNtuples(G4String volume, G4double energy, G4ThreeVector position, G4ThreeVector momentum);
+
+  // density derivative scores of the current event, per layer branch; with
+  // the sensitivity mode every primaries entry also fills the histogram
+  // "primaries_d<branch>" with weight times score, i.e. the derivative of
+  // the primaries spectrum with respect to the relative layer density
+  void SetSensitivityScores(const map<G4String, G4double> &scores) { fSensitivityScores = scores; }
+
+  // energy histograms of every branch plus the conversion primaries,
+  // merged into the master at the end of each run
+  const map<G4String, TH1D*> &GetHistograms() const { return fHistogramMap; }
+  void WriteHistograms(std::ostream &out) const;
+
+  // binning of the energy histograms, in keV
+  static const G4int kEnergyBins = 600;
+  static constexpr G4double kEnergyMin = 0.;
+  static constexpr G4double kEnergyMax = 60.;
+
+  // uncollided spectra of the source through the stack, binned as the
+  // energy histograms and scaled to nEvents primaries; master only, once
+  // a run, possibly an empty one, has built the physics tables
+  map<G4String, vector<G4double>> GetAnalyticSpectra(G4double nEvents);
+  void WriteAnalyticSpectra(G4String path);
+
+  // accumulator of the stepping time spent in a region, in seconds;
+  // the pointer stays valid for the lifetime of the run action; filled
+  // only in builds with GEMXRAY_INSTRUMENT
+  G4double *GetRegionTimer(G4String regionName) { return &fRegionTimeMap[regionName]; }
+
+  // counters and timers of this thread, used through INSTRUMENT(...)
+  Instrumentation &GetInstrumentation() { return fInstrumentation; }
+
+  // slowest events of this thread, merged into the master and written
+  // to slow-event-r<run>-e<event>.txt at the end of the run
+  SlowEventList &GetSlowEvents() { return fSlowEvents; }
+
+  // forced conversions tried and those without a conversion within the
+  // HEED trials, see HeedSimulation::ForcePhotonConversion
+  void CountForcedConversion(G4bool converted) { fForcedConversions++; if (!converted) fForcedConversionFailures++; }
+
+  // progress counters of this thread, 0 without a status file
+  RunStatus::Counters *GetStatusCounters() const { return fStatusCounters; }
   
   G4int nOfEvents;
 
@@ -75,11 +125,21 @@ public:
   G4DataVector *primaryAngles;
   G4DataVector *primaryAngularDist;
   G4double primaryAngularDistSum;*/
-  vector<std::pair<G4String, G4double>> fLayersMap;
+  LayerStack fLayersMap;
 
 private:
-
-  TFile *runFile;
+  void BookHistograms();
+  void MergeIntoMaster();
+  // summed over threads like the Instrumentation; prints nothing in
+  // builds without GEMXRAY_INSTRUMENT, where no region is timed
+  void PrintRegionTimes() const;
+  void WriteSlowEvents() const;
+  static G4String GetSlowEventPath(const SlowEvent &event);
+  void WriteSummary(G4String summaryPath, const G4Run *run);
+
+  static RunAction *fMasterRunAction;
+
+  TFile *runFile = 0;
   TTree *primaryTree;
   TTree *afterWindowTree;
   TTree *afterDriftTree;
@@ -89,6 +149,7 @@ private:
 
   // variables for ntuples
   map<G4String, G4double> *fHitEnergyMap;
+  map<G4String, G4double> fHitWeightMap;
   
   G4double gasPrimaries;
 
@@ -101,6 +162,17 @@ private:
   G4double hitMomentumZ;
 
   map<G4String, TTree*> treeMap;
+  map<G4String, ColumnWriter*> fColumnWriters; // same rows as the trees, empty if not written
+  map<G4String, TH1D*> fHistogramMap;
+  map<G4String, G4double> fRegionTimeMap;
+  Instrumentation fInstrumentation;
+  SlowEventList fSlowEvents;
+  G4long fForcedConversions = 0;
+  G4long fForcedConversionFailures = 0;
+  RunStatus::Counters *fStatusCounters = 0;
+  map<G4String, G4double> fSensitivityScores;
+  AnalyticAttenuation *fAnalyticAttenuation = 0;
+  std::chrono::steady_clock::time_point fRunStart;
   vector<G4String> volumeBranchNames;
   G4String volumes[6] = {"primary", "window", "driftKapton", "driftFr4", "driftCopper", "conversion"};
 };
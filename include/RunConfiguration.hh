@@ -0,0 +1,125 @@
+/// \file RunConfiguration.hh
+/// \brief Definition of the RunConfiguration class
+
+#ifndef RunConfiguration_h
+#define RunConfiguration_h 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include "SlowEventList.hh"
+
+/// Settings that may change between runs of the same process
+/// (source, spectrum file, output and summary files, variance reduction).
+///
+/// The instance is shared by all threads: it is written by the master
+/// only while no run is active and read by the user actions at the
+/// beginning of each run.
+
+class RunConfiguration
+{
+public:
+  static RunConfiguration* Instance();
+
+  G4String GetSource() const { return fSource; }
+  void SetSource(G4String source) { fSource = source; }
+
+  G4double GetMonoEnergy() const { return fMonoEnergy; }
+  void SetMonoEnergy(G4double monoEnergy) { fMonoEnergy = monoEnergy; }
+  // direction of the mono source, a pencil beam by default, see SourceDescription
+  G4double GetMonoMinCosTheta() const { return fMonoMinCosTheta; }
+  void SetMonoMinCosTheta(G4double monoMinCosTheta) { fMonoMinCosTheta = monoMinCosTheta; }
+
+  G4String GetSpectrumPath() const { return fSpectrumPath; }
+  void SetSpectrumPath(G4String spectrumPath) { fSpectrumPath = spectrumPath; }
+
+  // selects the spectrum of a library source, see SpectrumLibrary
+  G4double GetTubeVoltage() const { return fTubeVoltage; }
+  void SetTubeVoltage(G4double tubeVoltage) { fTubeVoltage = tubeVoltage; }
+
+  // focal-spot image, "x y w" in mm, see PhaseSpaceTable; empty for a point source
+  G4String GetSpotPath() const { return fSpotPath; }
+  void SetSpotPath(G4String spotPath) { fSpotPath = spotPath; }
+
+  G4String GetOutFilePath() const { return fOutFilePath; }
+  void SetOutFilePath(G4String outFilePath) { fOutFilePath = outFilePath; }
+
+  // directory of raw column files, see ColumnWriter; empty to skip them
+  G4String GetColumnsPath() const { return fColumnsPath; }
+  void SetColumnsPath(G4String columnsPath) { fColumnsPath = columnsPath; }
+
+  G4String GetSummaryPath() const { return fSummaryPath; }
+  void SetSummaryPath(G4String summaryPath) { fSummaryPath = summaryPath; }
+
+  // progress file rewritten during the run, see RunStatus
+  G4String GetStatusPath() const { return fStatusPath; }
+  void SetStatusPath(G4String statusPath) { fStatusPath = statusPath; }
+  G4double GetStatusInterval() const { return fStatusInterval; }
+  void SetStatusInterval(G4double statusInterval) { fStatusInterval = statusInterval; }
+
+  // fixed at startup, with the geometry and physics list
+  G4bool GetImportanceBiasing() const { return fImportanceBiasing; }
+  void SetImportanceBiasing(G4bool importanceBiasing) { fImportanceBiasing = importanceBiasing; }
+
+  // one conversion entry per gas particle instead of one per primary
+  // photon; always with importance biasing, whose split copies cannot be
+  // added together, and on request for an analog reference to compare with
+  G4bool GetParticleConversions() const { return fParticleConversions; }
+  void SetParticleConversions(G4bool particleConversions) { fParticleConversions = particleConversions; }
+
+  G4bool GetForcedConversion() const { return fForcedConversion; }
+  void SetForcedConversion(G4bool forcedConversion) { fForcedConversion = forcedConversion; }
+
+  // independent primary photons per event, bookkept separately so that
+  // the output is that of as many one-photon events
+  G4int GetPhotonsPerEvent() const { return fPhotonsPerEvent; }
+  void SetPhotonsPerEvent(G4int photonsPerEvent) { fPhotonsPerEvent = photonsPerEvent; }
+
+  // scrambled Sobol points instead of pseudo-random numbers for the
+  // primary energy and direction, see SobolSequence
+  G4bool GetQuasiRandom() const { return fQuasiRandom; }
+  void SetQuasiRandom(G4bool quasiRandom) { fQuasiRandom = quasiRandom; }
+  G4long GetQuasiRandomSeed() const { return fQuasiRandomSeed; }
+  void SetQuasiRandomSeed(G4long quasiRandomSeed) { fQuasiRandomSeed = quasiRandomSeed; }
+
+  // fixed at startup, the derivative histograms are booked with the first run
+  G4bool GetSensitivity() const { return fSensitivity; }
+  void SetSensitivity(G4bool sensitivity) { fSensitivity = sensitivity; }
+
+  // slowest events kept per run and written for replay, zero for none
+  G4int GetSlowEvents() const { return fSlowEvents; }
+  void SetSlowEvents(G4int slowEvents) { fSlowEvents = slowEvents; }
+
+  // every event starts from the engine state of this one, 0 if not replaying
+  const SlowEvent *GetReplayEvent() const { return fReplaying ? &fReplayEvent : 0; }
+  void SetReplayEvent(const SlowEvent &replayEvent) { fReplayEvent = replayEvent; fReplaying = true; }
+
+private:
+  RunConfiguration();
+
+  G4String fSource = "xray"; // mono, a name in sources/ or a .src path, see SourceDescription
+  G4double fMonoEnergy = 5.9; // keV, energy of the mono source
+  G4double fMonoMinCosTheta = 1.;
+  G4String fSpectrumPath = "xray-spectrum.csv"; // energy-angle table for phasespace
+  G4double fTubeVoltage = 50.; // kV
+  G4String fSpotPath = "";
+  G4String fOutFilePath = "temp.root"; // empty to skip the ROOT output
+  G4String fColumnsPath = "";
+  G4String fSummaryPath = ""; // JSON run summary, empty to skip it
+  G4String fStatusPath = ""; // empty for none
+  G4double fStatusInterval = 10.; // seconds
+  G4bool fImportanceBiasing = false; // photon weights may differ from one
+  G4bool fParticleConversions = false;
+  G4bool fForcedConversion = false; // force the gas conversion of every photon, weighted
+  G4int fPhotonsPerEvent = 1;
+  G4bool fQuasiRandom = false;
+  G4long fQuasiRandomSeed = 0; // scrambling seed, combined with the run number
+  G4bool fSensitivity = false; // primaries derivatives with respect to the layer densities
+  G4int fSlowEvents = 0;
+  G4bool fReplaying = false;
+  SlowEvent fReplayEvent;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
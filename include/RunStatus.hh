@@ -0,0 +1,78 @@
+/// \file RunStatus.hh
+/// \brief Definition of the RunStatus class
+
+#ifndef RunStatus_h
+#define RunStatus_h 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/// Progress of the current run in a small JSON file (--status-file),
+/// rewritten every few seconds by a background thread of the master, so
+/// that batch monitoring can poll it instead of parsing the output.
+///
+/// Every thread counts its events and conversion weights in counters of
+/// its own, on a separate cache line; only that thread writes them and
+/// the status thread merely reads them. The file is written next to its
+/// final path and renamed over it, so a reader never sees it half written.
+/// It holds the events done and to do, the total and per-thread rates, an
+/// estimated time to completion, the memory use and the relative
+/// precision of the conversion count.
+
+class RunStatus
+{
+public:
+  static RunStatus* Instance();
+
+  struct alignas(64) Counters {
+    std::atomic<G4long> events{0};
+    std::atomic<G4double> conversions{0.}; // sum of weights
+    std::atomic<G4double> conversions2{0.}; // sum of squared weights
+
+    void AddEvent() { events.store(events.load(std::memory_order_relaxed)+1, std::memory_order_relaxed); }
+    void AddConversion(G4double weight) {
+      conversions.store(conversions.load(std::memory_order_relaxed)+weight, std::memory_order_relaxed);
+      conversions2.store(conversions2.load(std::memory_order_relaxed)+weight*weight, std::memory_order_relaxed);
+    }
+  };
+
+  // counters of the calling thread, 0 unless a status file is being written
+  Counters *GetCounters();
+
+  // master only, at the beginning and at the end of each run
+  void Start(G4String path, G4double interval, G4int runID, G4long eventsToProcess);
+  void Stop();
+
+private:
+  RunStatus();
+
+  void Loop();
+  void Write(G4bool finished);
+
+  static const G4int kMaxThreads = 256;
+  typedef std::chrono::steady_clock Clock;
+
+  Counters fCounters[kMaxThreads+1]; // the sequential or master thread first
+  G4long fLastEvents[kMaxThreads+1]; // at the previous write, for the rates
+
+  G4String fPath = "";
+  G4double fInterval = 10.;
+  G4int fRunID = 0;
+  G4long fEventsToProcess = 0;
+  Clock::time_point fStart, fLastWrite;
+
+  std::thread fThread;
+  std::mutex fMutex;
+  std::condition_variable fStopCondition;
+  G4bool fStopping = false;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
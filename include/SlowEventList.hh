@@ -0,0 +1,72 @@
+/// \file SlowEventList.hh
+/// \brief Definition of the SlowEventList class
+
+#ifndef SlowEventList_h
+#define SlowEventList_h 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include <map>
+#include <vector>
+
+/// One event worth replaying: its wall time, what it produced and the
+/// random engine state at the start of its primary generation, together
+/// with the settings that decide which random numbers are drawn: the
+/// source, the focal spot and whether the layer importances split tracks.
+/// The geometry and physics are not recorded and must be given again.
+/// HEED draws from Garfield's engine, one for the whole process: with
+/// several worker threads the others draw from it during the event, so
+/// only the Geant4 part of an event recorded in a multithreaded run
+/// replays exactly.
+
+struct SlowEvent {
+  G4int runID = 0;
+  G4int eventID = 0;
+  G4double seconds = 0.;
+  G4long steps = 0;
+  std::map<G4String, G4int> tracks; // per particle name
+  G4String source, spectrumPath, spotPath;
+  G4double tubeVoltage = 0.;
+  G4int photonsPerEvent = 1;
+  G4bool forcedConversion = false;
+  G4bool quasiRandom = false;
+  G4long quasiRandomSeed = 0;
+  G4bool importanceBiasing = false;
+  G4int threads = 1; // workers of the recording run
+  G4String engineState; // HepRandomEngine::put
+};
+
+/// The slowest events of a run (--slow-events N), at most N of them.
+///
+/// Every worker keeps its own list, a min-heap on the wall time, so that
+/// an event faster than the N-th slowest costs one comparison; the lists
+/// are merged into the master at the end of the run. Each kept event is
+/// written to a text file that --replay-event runs again.
+
+class SlowEventList
+{
+public:
+  void SetCapacity(size_t capacity) { fCapacity = capacity; }
+  size_t GetCapacity() const { return fCapacity; }
+  void Clear() { fEvents.clear(); }
+
+  // shortest time an event needs to enter the list
+  G4double GetThreshold() const { return fEvents.size()<fCapacity ? 0. : fEvents.front().seconds; }
+  void Add(const SlowEvent &event);
+  void Merge(const SlowEventList &other);
+
+  // slowest first
+  std::vector<SlowEvent> GetSorted() const;
+
+  static void Write(const SlowEvent &event, G4String path);
+  static G4bool Read(G4String path, SlowEvent &event);
+
+private:
+  size_t fCapacity = 0;
+  std::vector<SlowEvent> fEvents; // heap, fastest in front
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,41 @@
+/// \file SobolSequence.hh
+/// \brief Definition of the SobolSequence class
+
+#ifndef SobolSequence_h
+#define SobolSequence_h 1
+
+#include <cstdint>
+
+/// Owen-scrambled Sobol points in up to GetMaxDimensions() dimensions.
+///
+/// Points are computed directly from their index, so that every thread
+/// can draw the point of its own event without sharing any state. The
+/// scrambling is the hash-based nested uniform scramble of Laine and
+/// Karras (as in Burley, "Practical hash-based Owen scrambling", 2020),
+/// with a different seed for every dimension: it keeps the stratification
+/// of the sequence and makes every coordinate uniform, so that the
+/// estimates stay unbiased and replicas with different seeds give
+/// their error.
+
+class SobolSequence
+{
+public:
+  SobolSequence(uint32_t seed = 0);
+
+  // coordinate of point index, strictly between 0 and 1
+  double Get(uint32_t index, int dimension) const;
+
+  static int GetMaxDimensions() { return nDimensions; }
+
+private:
+  static const int nDimensions = 8;
+  static uint32_t ReverseBits(uint32_t x);
+  static uint32_t Hash(uint32_t x);
+
+  uint32_t fDirections[nDimensions][32];
+  uint32_t fSeeds[nDimensions];
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,77 @@
+/// \file SourceDescription.hh
+/// \brief Definition of the SourceDescription class
+
+#ifndef SourceDescription_h
+#define SourceDescription_h 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include <vector>
+
+/// Photon source read from a description file, sources/<name>.src unless
+/// the name is itself a path. One statement per line, "#" for comments:
+///   line <energy keV> <intensity>        a discrete line
+///   spectrum <path|configured> [weight]   "E, w" CSV spectrum, normalised
+///                                         and scaled by weight (default 1);
+///                                         configured is --spectrum-file
+///   source <name> <weight>                another source, normalised and
+///                                         scaled by weight (mixtures)
+///   phasespace [path]                     energy-angle PhaseSpaceTable,
+///                                         the configured file by default
+///   library <path> [filter]               tube spectrum at the configured
+///                                         voltage from a SpectrumLibrary,
+///                                         filtration "none" by default
+///   direction pencil | cone <half-angle deg>
+/// Lines, spectra and sources all end up in one list of energies with
+/// their probabilities. The source "mono" is built in, at the configured
+/// mono energy, a pencil beam unless a cone is configured for it. A source without any energy is an error.
+///
+/// Errors are fatal unless the description is only being checked, then
+/// the first one is kept for GetError() (e.g. to reject a server job).
+
+class SourceDescription
+{
+public:
+  SourceDescription(G4String source, G4String spectrumPath, G4bool fatal = true);
+
+  // first error of a non-fatal description, empty if none
+  G4String GetError() const { return fError; }
+
+  // energies (keV) and normalised probabilities
+  const std::vector<G4double> &GetEnergies() const { return fEnergies; }
+  const std::vector<G4double> &GetProbabilities() const { return fProbabilities; }
+
+  // cos(theta) is uniform between this and one, one for a pencil beam
+  G4double GetMinCosTheta() const { return fMinCosTheta; }
+
+  // energy and angle from a table instead, empty if none
+  G4String GetPhaseSpacePath() const { return fPhaseSpacePath; }
+
+  // energy from a spectrum library instead, empty path if none
+  G4String GetLibraryPath() const { return fLibraryPath; }
+  G4String GetLibraryFilter() const { return fLibraryFilter; }
+
+  // every file the source depends on, the description files included
+  const std::vector<G4String> &GetInputPaths() const { return fInputPaths; }
+
+private:
+  void Read(G4String source, G4String spectrumPath, G4int depth);
+  void AddSpectrum(G4String path, G4double scale);
+  void Normalise(size_t first, G4double scale);
+  void Fail(const char *where, G4String message);
+
+  std::vector<G4double> fEnergies;
+  std::vector<G4double> fProbabilities;
+  G4double fMinCosTheta = 1.;
+  G4String fPhaseSpacePath = "";
+  G4String fLibraryPath = "";
+  G4String fLibraryFilter = "none";
+  std::vector<G4String> fInputPaths;
+  G4bool fFatal;
+  G4String fError = "";
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,66 @@
+/// \file SpectrumLibrary.hh
+/// \brief Definition of the SpectrumLibrary class
+
+#ifndef SpectrumLibrary_h
+#define SpectrumLibrary_h 1
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Tube spectra for many voltage and filtration settings, packed by
+/// pack-spectra.py into one binary file and mapped read-only into memory:
+/// opening costs the same for any number of settings and the pages are
+/// shared by all threads and processes using the library.
+///
+/// Every setting is stored as its quantile function, the energies at
+/// evenly spaced cumulative probabilities. Between two tabulated voltages
+/// of the same filtration the CDFs are interpolated linearly at fixed
+/// energy and the result inverted again: characteristic lines stay at
+/// their energies with interpolated intensities, and the bremsstrahlung
+/// endpoint is that of the higher voltage, with the weight of its
+/// interpolation fraction.
+///
+/// File layout, little-endian: "GEMSPEC1", number of settings and of
+/// quantile steps (uint32 each), then per setting the voltage (float64),
+/// the filtration label (24 chars, zero padded) and the offset of its
+/// table (uint64), then the tables of steps+1 float64 energies in keV.
+
+class SpectrumLibrary
+{
+public:
+  SpectrumLibrary();
+  virtual ~SpectrumLibrary();
+
+  // false if the file cannot be mapped or is not a library
+  bool Open(const std::string &path);
+
+  // quantile function at a voltage, of the CDF interpolated between the
+  // neighbouring settings; empty if the voltage lies outside the settings
+  // of that filtration
+  std::vector<double> GetQuantiles(double voltage, const std::string &filter) const;
+
+  // settings as voltage and filtration label
+  int GetNSettings() const { return fNSettings; }
+  double GetVoltage(int setting) const;
+  std::string GetFilter(int setting) const;
+
+private:
+  struct Entry {
+    double voltage;
+    char filter[24];
+    uint64_t offset;
+  };
+  const Entry *GetEntry(int setting) const;
+  void Close();
+
+  const char *fData = 0;
+  size_t fSize = 0;
+  int fNSettings = 0;
+  int fNQuantiles = 0;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,58 @@
+/// \file StartupProfile.hh
+/// \brief Definition of the StartupProfile class
+
+#ifndef StartupProfile_h
+#define StartupProfile_h 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/// Wall-clock breakdown of the process initialisation (--startup-profile).
+///
+/// Each section is timed once, the first time it completes on any thread;
+/// later runs and other threads do not change it. Sections may begin and
+/// end in different user classes, as long as the names match.
+
+class StartupProfile
+{
+public:
+  static StartupProfile* Instance();
+
+  void SetEnabled(G4bool enabled) { fEnabled = enabled; }
+  G4bool IsEnabled() const { return fEnabled; }
+
+  void Begin(G4String section);
+  void End(G4String section);
+  void Print();
+
+  /// Times a section for the lifetime of the object
+  class Scope {
+  public:
+    Scope(G4String section): fSection(section) { StartupProfile::Instance()->Begin(fSection); }
+    ~Scope() { StartupProfile::Instance()->End(fSection); }
+  private:
+    G4String fSection;
+  };
+
+private:
+  StartupProfile();
+
+  typedef std::chrono::steady_clock Clock;
+
+  G4bool fEnabled = false;
+  G4bool fPrinted = false;
+  Clock::time_point fProcessStart;
+  std::map<G4String, Clock::time_point> fBeginTimes;
+  std::vector<std::pair<G4String, G4double>> fSectionTimes; // in completion order
+  std::mutex fMutex;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
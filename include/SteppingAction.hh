@@ -31,13 +31,18 @@
 #define SteppingAction_h 1
 
 #include<vector>
+#include<chrono>
 
 #include "G4UserSteppingAction.hh"
 #include "globals.hh"
 
+#include "LayerDescription.hh"
+
 class EventAction;
+class AttenuationTable;
 
 class G4LogicalVolume;
+class G4Region;
 
 /// Stepping action class
 /// 
@@ -59,9 +64,19 @@ private:
   G4LogicalVolume* driftCopperVolume;
   G4LogicalVolume* driftGapVolume;
 
-  std::vector<std::pair<G4String, G4double>> fLayersMap;
+  LayerStack fLayersMap;
   std::vector<G4LogicalVolume *> volumesBeforeDrift;
   std::vector<G4String> volumeBranchNames;
+  G4int fTrackID = 0;
+  G4int fPrimary = 0; // primary photon of fTrackID in its event
+
+  // photon attenuation in each layer, for the sensitivity scores
+  std::vector<AttenuationTable *> fAttenuationTables;
+
+  // time between consecutive steps, charged to the region of the step
+  std::chrono::steady_clock::time_point fLastStepTime;
+  G4Region *fLastRegion = 0;
+  G4double *fRegionTime = 0;
   /*std::map<std::string, std::string> volumeBranchNames;
   std::string volumeNamesBeforeDrift[4] = {
   	"WindowKaptonLogical",
@@ -0,0 +1,60 @@
+/// \file TransferMatrixCache.hh
+/// \brief Definition of the TransferMatrixCache class
+
+#ifndef TransferMatrixCache_h
+#define TransferMatrixCache_h 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include "LayerDescription.hh"
+#include "ResponseMatrix.hh"
+
+/// Directory of photon transfer matrices, one per slab (material,
+/// thickness and EM settings of a layer): element (out, in) is the number
+/// of photons leaving the slab in energy bin out per photon of energy
+/// bin in hitting it head-on, fluorescence and scattering included.
+///
+/// Build() fills the matrix of a one-slab stack with monoenergetic runs;
+/// Compose() multiplies the cached matrices of any stack into the spectra
+/// after each layer without Geant4. Vacuum layers use air slabs, like the
+/// envelope. Photon directions are not carried between slabs, so the
+/// composition is an approximation for thin or forward-peaked stacks.
+
+class TransferMatrixCache
+{
+public:
+  // defaultCut: the --cut of layers without their own, in mm, negative
+  // for the PhysicsList defaults
+  TransferMatrixCache(G4String directory, G4String emOption, G4double defaultCut);
+
+  G4String GetPath(const LayerDescription &layer) const;
+  G4bool Has(const LayerDescription &layer) const;
+  // the slab of a one-layer stack is cached
+  G4bool Has(const LayerStack &layers) const;
+
+  // the stack must have a single non-vacuum layer; runs eventsPerEnergy
+  // primaries at every bin centre with the mono source
+  void Build(const LayerStack &layers, G4int eventsPerEnergy);
+
+  // spectra after every layer and at the gas gap entry for the source,
+  // written as JSON in the layout of the run summary histograms
+  void Compose(const LayerStack &layers, G4String source, G4String spectrumPath, G4String outPath) const;
+
+private:
+  // the only non-vacuum layer of a one-slab stack
+  G4bool GetSlab(const LayerStack &layers, LayerDescription &slab) const;
+
+  G4String fDirectory;
+  G4String fEmOption;
+  G4double fDefaultCut;
+
+  // input and output binning, as the RunAction energy histograms
+  const G4int fNBins = 600;
+  const G4double fMinEnergy = 0.;
+  const G4double fMaxEnergy = 60.;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,46 @@
+/// \file Unfolding.hh
+/// \brief Definition of the Unfolding class
+
+#ifndef Unfolding_h
+#define Unfolding_h 1
+
+#include "ResponseMatrix.hh"
+
+#include <vector>
+
+/// Estimates the input spectrum of a ResponseMatrix from a measured
+/// output spectrum, either by MLEM (Richardson-Lucy) iterations or by
+/// least squares with a second-difference (Tikhonov) penalty, solved by
+/// conjugate gradients on the normal equations.
+///
+/// Plain C++ like ResponseMatrix. The matrix is never transposed or
+/// copied: the forward product splits the output bins and the transposed
+/// product the input bins among the threads, each running contiguous
+/// loops over the matrix columns.
+
+class Unfolding
+{
+public:
+  Unfolding(const ResponseMatrix &matrix, int nThreads = 1);
+
+  // measured must have GetNOut() bins; both start from a flat spectrum
+  std::vector<double> Mlem(const std::vector<double> &measured, int iterations) const;
+  std::vector<double> Tikhonov(const std::vector<double> &measured, double regularisation, int iterations) const;
+
+  // chi2 of the folded estimate against the measurement, Poisson errors
+  double Chi2(const std::vector<double> &measured, const std::vector<double> &estimate) const;
+
+  std::vector<double> Forward(const std::vector<double> &input) const;
+  std::vector<double> Transposed(const std::vector<double> &output) const;
+
+private:
+  template <typename Function> void ParallelFor(int n, Function function) const;
+
+  const ResponseMatrix &fMatrix;
+  int fNThreads;
+  std::vector<double> fEfficiency; // column sums, detected fraction per input bin
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
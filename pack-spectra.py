@@ -0,0 +1,70 @@
+#!/usr/bin/python3
+
+import os, sys
+import argparse
+import struct
+
+MAGIC = b'GEMSPEC1'
+
+def read_spectrum(path):
+    ''' (energy, intensity) points of an "E, w" CSV spectrum '''
+    points = list()
+    with open(path) as spectrumFile:
+        for line in spectrumFile:
+            fields = line.split(',')
+            try: energy, intensity = float(fields[0]), float(fields[1])
+            except (ValueError, IndexError): continue
+            points.append((energy, max(intensity, 0.)))
+    points.sort()
+    return points
+
+def quantiles(points, nQuantiles):
+    ''' Energies at probabilities 0, 1/n, ..., 1 of the spectrum, every point
+    being a bin centred on its energy with a piecewise linear CDF '''
+    energies = [e for e, w in points]
+    edges = [energies[0]-0.5*(energies[1]-energies[0])]
+    edges += [0.5*(a+b) for a, b in zip(energies[:-1], energies[1:])]
+    edges.append(energies[-1]+0.5*(energies[-1]-energies[-2]))
+    total = sum(w for e, w in points)
+    if total<=0: raise ValueError('empty spectrum')
+
+    result = list()
+    cumulative, point = 0., 0
+    for k in range(nQuantiles+1):
+        target = total*k/nQuantiles
+        # first bin whose cumulative sum reaches the target, skipping empty bins
+        while point<len(points)-1 and (cumulative+points[point][1]<target or points[point][1]==0):
+            cumulative += points[point][1]
+            point += 1
+        weight = points[point][1]
+        fraction = min(max((target-cumulative)/weight, 0.), 1.) if weight>0 else 1.
+        result.append(edges[point]+fraction*(edges[point+1]-edges[point]))
+    return result
+
+def main():
+    ap = argparse.ArgumentParser(add_help=True, description='Pack CSV tube spectra into a binary spectrum library for gem-xray')
+    ap.add_argument('-o', '--output', default='spectra.speclib')
+    ap.add_argument('-s', '--spectrum', nargs=3, action='append', required=True, metavar=('KV', 'FILTER', 'CSV'),
+        help='tube voltage, filtration label and spectrum file, repeated for every setting')
+    ap.add_argument('--quantiles', type=int, default=4096, help='probability steps of every tabulated CDF')
+    options = ap.parse_args(sys.argv[1:])
+
+    # header, index of (kV, filter, offset), then one quantile table per setting;
+    # little-endian, offsets from the start of the file and 8-byte aligned
+    settings = sorted((float(kv), label, path) for kv, label, path in options.spectrum)
+    headerSize, entrySize = 16, 40
+    tableSize = 8*(options.quantiles+1)
+    with open(options.output+'.tmp', 'wb') as libraryFile:
+        libraryFile.write(MAGIC+struct.pack('<II', len(settings), options.quantiles))
+        for i, (kv, label, path) in enumerate(settings):
+            if len(label.encode())>23: raise ValueError('filter label too long: '+label)
+            offset = headerSize+entrySize*len(settings)+tableSize*i
+            libraryFile.write(struct.pack('<d24sQ', kv, label.encode(), offset))
+        for kv, label, path in settings:
+            table = quantiles(read_spectrum(path), options.quantiles)
+            libraryFile.write(struct.pack('<%dd'%len(table), *table))
+            print('%6g kV %-10s %s, %g-%g keV'%(kv, label, path, table[0], table[-1]))
+    os.replace(options.output+'.tmp', options.output)
+    print('Spectrum library written to', options.output)
+
+if __name__=='__main__': main()
@@ -0,0 +1,133 @@
+#!/usr/bin/python3
+
+import os, sys
+import argparse
+import json
+import subprocess
+import tempfile
+import time
+
+GEOMETRIES = ['10x10', 'ME0', 'custom', 'custom10x10']
+SOURCES = ['mono', 'fe55', 'cd109', 'xray', 'phasespace', 'tube']
+
+# slower, longer to start or larger than the baseline by more than these fractions fails
+DEFAULT_TOLERANCES = {'events_per_second': 0.15, 'startup_seconds': 0.25, 'peak_rss_kb': 0.10}
+
+def run(options, workDir, geometry, source):
+    ''' Runs one fixed-seed job, returns events/s, startup seconds and peak RSS '''
+    macroPath = os.path.join(workDir, 'regression.mac')
+    summaryPath = os.path.join(workDir, 'summary.json')
+    with open(macroPath, 'w') as macroFile:
+        macroFile.write('/run/initialize\n/run/beamOn %d\n'%options.events)
+
+    # physics tables shared by all the jobs of the geometry, as in production
+    command = [options.executable, '--geometry', geometry, '--spectrum', source, '--seed', str(options.seed),
+        '--physics-tables', os.path.join(workDir, 'physics-tables'), '--result-cache', 'none', '--out', '', '--summary', summaryPath, '--run', macroPath]
+    # the phasespace source reads an energy-angle table instead of a spectrum
+    if source=='phasespace': command += ['--spectrum-file', 'phasespace-example.txt']
+    if options.verbose: print(' '.join(command))
+    start = time.monotonic()
+    subprocess.run(command, check=True, stdout=None if options.verbose else subprocess.DEVNULL)
+    wallSeconds = time.monotonic()-start
+
+    with open(summaryPath) as summaryFile: summary = json.load(summaryFile)
+    return {
+        'events_per_second': summary['events_per_second'],
+        'startup_seconds': wallSeconds-summary['seconds'],
+        'peak_rss_kb': summary['peak_rss_kb']
+    }
+
+def measure(options, workDir, geometry, source):
+    ''' Best of the repetitions, the noise only ever makes a job slower '''
+    results = [run(options, workDir, geometry, source) for repetition in range(options.repeat)]
+    return {
+        'events_per_second': max(r['events_per_second'] for r in results),
+        'startup_seconds': min(r['startup_seconds'] for r in results),
+        'peak_rss_kb': min(r['peak_rss_kb'] for r in results)
+    }
+
+def compare(current, reference, tolerances):
+    ''' Regressions of one configuration, as (metric, current, reference) '''
+    regressions = list()
+    for metric, tolerance in tolerances.items():
+        if metric not in reference: continue
+        if metric=='events_per_second': failed = current[metric]<reference[metric]*(1-tolerance)
+        else: failed = current[metric]>reference[metric]*(1+tolerance)
+        if failed: regressions.append((metric, current[metric], reference[metric]))
+    return regressions
+
+def main():
+    ap = argparse.ArgumentParser(add_help=True)
+    ap.add_argument('-o', '--output', default='perf-regression.json')
+    ap.add_argument('--baseline', default='perf/baseline.json')
+    ap.add_argument('--update', action='store_true', help='write the measured values as the new baseline')
+    ap.add_argument('--executable', default='./gem-xray')
+    ap.add_argument('--geometries', nargs='+', default=GEOMETRIES)
+    ap.add_argument('--sources', nargs='+', default=SOURCES)
+    ap.add_argument('--events', type=int, default=None, help='per job, by default that of the baseline')
+    ap.add_argument('--seed', type=int, default=None)
+    ap.add_argument('--repeat', type=int, default=2, help='jobs per configuration, the best one counts')
+    ap.add_argument('--skip-code', type=int, default=0, help='exit code when configurations have no baseline, 77 for CTest')
+    ap.add_argument('-v', '--verbose', action='store_true')
+    options = ap.parse_args(sys.argv[1:])
+
+    baseline = {'events': 2000, 'seed': 12345, 'tolerances': DEFAULT_TOLERANCES, 'configurations': dict()}
+    if os.path.exists(options.baseline):
+        with open(options.baseline) as baselineFile: baseline.update(json.load(baselineFile))
+    # the numbers are only comparable for the same jobs
+    if options.events is None: options.events = baseline['events']
+    if options.seed is None: options.seed = baseline['seed']
+    comparable = options.events==baseline['events'] and options.seed==baseline['seed']
+    if not comparable and not options.update: sys.exit('Events or seed differ from the baseline, nothing can be compared')
+
+    # nothing to compare against, not a failure: the numbers are measured
+    # on the reference machine with --update
+    names = ['%s/%s'%(geometry, source) for geometry in options.geometries for source in options.sources]
+    if not options.update and not any(name in baseline['configurations'] for name in names):
+        print('No baseline in %s for these configurations, skipped'%options.baseline)
+        sys.exit(options.skip_code)
+
+    report = {'events': options.events, 'seed': options.seed, 'configurations': dict(), 'regressions': list(), 'missing': list()}
+    with tempfile.TemporaryDirectory() as workDir:
+        for geometry in options.geometries:
+            # builds the physics tables of the geometry, not measured
+            run(options, workDir, geometry, options.sources[0])
+            for source in options.sources:
+                name = '%s/%s'%(geometry, source)
+                current = measure(options, workDir, geometry, source)
+                report['configurations'][name] = current
+                reference = baseline['configurations'].get(name)
+                status = 'new'
+                if reference is None and not options.update:
+                    report['missing'].append(name)
+                    status = 'skipped'
+                elif reference is not None and comparable:
+                    tolerances = dict(baseline['tolerances'])
+                    tolerances.update(reference.get('tolerances', dict()))
+                    regressions = compare(current, reference, tolerances)
+                    for metric, value, referenceValue in regressions:
+                        report['regressions'].append({'configuration': name, 'metric': metric, 'value': value, 'baseline': referenceValue})
+                    status = 'FAILED' if regressions else 'ok'
+                print('%-24s %12.1f events/s %8.2f s startup %10d kB   %s'%(name, current['events_per_second'], current['startup_seconds'], current['peak_rss_kb'], status))
+
+    with open(options.output, 'w') as outputFile: json.dump(report, outputFile, indent=2)
+    print('Report written to', options.output)
+
+    if options.update:
+        for name, current in report['configurations'].items():
+            # tolerances set by hand for a configuration are kept
+            tolerances = baseline['configurations'].get(name, dict()).get('tolerances')
+            baseline['configurations'][name] = dict(current, **({'tolerances': tolerances} if tolerances else dict()))
+        baseline['events'], baseline['seed'] = options.events, options.seed
+        with open(options.baseline, 'w') as baselineFile: json.dump(baseline, baselineFile, indent=2)
+        print('Baseline written to', options.baseline)
+        return
+
+    for regression in report['regressions']:
+        print('Regression in %s: %s %g against %g in the baseline'%(regression['configuration'], regression['metric'], regression['value'], regression['baseline']))
+    for name in report['missing']:
+        print('No baseline for %s, skipped'%name)
+    if report['regressions']: sys.exit(1)
+    if report['missing']: sys.exit(options.skip_code)
+
+if __name__=='__main__': main()
@@ -32,18 +32,17 @@
 #include "RunAction.hh"
 #include "EventAction.hh"
 #include "SteppingAction.hh"
+#include "ExceptionHandler.hh"
 
 using std::string;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-ActionInitialization::ActionInitialization(G4bool headless, string outFilePath, string source, std::vector<std::pair<G4String, G4double>> layersMap)
+ActionInitialization::ActionInitialization(G4bool headless, LayerStack layersMap)
 : G4VUserActionInitialization(),
   fHeadless(true)
 {
   fHeadless = headless;
-  fOutFilePath = outFilePath;
-  fSource = source;
   fLayersMap = layersMap;
 }
 
@@ -56,7 +55,9 @@ ActionInitialization::~ActionInitialization()
 
 void ActionInitialization::BuildForMaster() const
 {
-  RunAction* runAction = new RunAction(fHeadless, fOutFilePath, fLayersMap);
+  new ExceptionHandler(); // registers itself, replacing the default one
+
+  RunAction* runAction = new RunAction(fHeadless, fLayersMap);
   SetUserAction(runAction);
 }
 
@@ -64,13 +65,15 @@ void ActionInitialization::BuildForMaster() const
 
 void ActionInitialization::Build() const
 {
-  RunAction* runAction = new RunAction(fHeadless, fOutFilePath, fLayersMap);
+  new ExceptionHandler(); // registers itself, replacing the default one
+
+  RunAction* runAction = new RunAction(fHeadless, fLayersMap);
   SetUserAction(runAction);
   
   EventAction* eventAction = new EventAction(runAction);
   SetUserAction(eventAction);
 
-  SetUserAction(new PrimaryGeneratorAction(eventAction, fSource, fHeadless));
+  SetUserAction(new PrimaryGeneratorAction(eventAction, fHeadless));
   
   SetUserAction(new SteppingAction(eventAction));
 }  
@@ -0,0 +1,54 @@
+/// \file AliasTable.cc
+/// \brief Implementation of the AliasTable class
+
+#include "AliasTable.hh"
+
+#include <numeric>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+AliasTable::AliasTable(const std::vector<double> &weights) {
+  int n = weights.size();
+  fProbabilities.assign(n, 1.);
+  fAliases.resize(n);
+  std::iota(fAliases.begin(), fAliases.end(), 0);
+  fWeights.assign(n, 0.);
+  double sum = 0.;
+  for (double weight:weights) sum += weight>0. ? weight : 0.;
+  if (sum<=0.) return;
+
+  // columns below the mean are topped up from columns above it
+  std::vector<double> scaled(n);
+  std::vector<int> small, large;
+  for (int i=0; i<n; i++) {
+    fWeights[i] = weights[i]>0. ? weights[i]/sum : 0.;
+    scaled[i] = fWeights[i]*n;
+    if (scaled[i]<1.) small.push_back(i);
+    else large.push_back(i);
+  }
+  while (!small.empty() && !large.empty()) {
+    int less = small.back(), more = large.back();
+    small.pop_back();
+    fProbabilities[less] = scaled[less];
+    fAliases[less] = more;
+    scaled[more] -= 1.-scaled[less];
+    if (scaled[more]<1.) {
+      large.pop_back();
+      small.push_back(more);
+    }
+  }
+  // what is left is one up to rounding
+  for (int i:small) fProbabilities[i] = 1.;
+  for (int i:large) fProbabilities[i] = 1.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+int AliasTable::Sample(double random) const {
+  double column = random*fProbabilities.size();
+  int index = (int)column;
+  if (index>=(int)fProbabilities.size()) index = fProbabilities.size()-1;
+  return column-index<fProbabilities[index] ? index : fAliases[index];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,77 @@
+/// \file AnalyticAttenuation.cc
+/// \brief Implementation of the AnalyticAttenuation class
+
+#include "AnalyticAttenuation.hh"
+
+#include "G4Material.hh"
+#include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <cmath>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+AnalyticAttenuation::AnalyticAttenuation(LayerStack layers) {
+  G4int materialIndex = 0;
+  for (auto layer:layers) {
+    const G4Material *material;
+    if (layer.material==G4String("vacuum")) {
+      material = G4Material::GetMaterial("G4_AIR");
+      fBranchNames.push_back("");
+    } else {
+      materialIndex++;
+      G4String branchName = layer.material+std::to_string(materialIndex);
+      material = G4LogicalVolumeStore::GetInstance()->GetVolume(G4String("Logical")+branchName)->GetMaterial();
+      fBranchNames.push_back(branchName);
+    }
+    fThicknesses.push_back(layer.thickness*mm);
+    fTables.push_back(new AttenuationTable(material));
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+AnalyticAttenuation::~AnalyticAttenuation() {
+  for (auto table:fTables) delete table;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::map<G4String, std::vector<G4double>> AnalyticAttenuation::Compute(const std::vector<G4double> &energies,
+                                                                      const std::vector<G4double> &probabilities,
+                                                                      G4double minCosTheta, G4double nEvents,
+                                                                      G4int nBins, G4double minEnergy, G4double maxEnergy) const {
+  std::map<G4String, std::vector<G4double>> spectra;
+  spectra["primary"] = std::vector<G4double>(nBins, 0.);
+  for (G4String branchName:fBranchNames) if (branchName!="") spectra[branchName] = std::vector<G4double>(nBins, 0.);
+
+  // midpoints in cos(theta), a single direction for a pencil beam
+  G4int nDirections = minCosTheta<1. ? fDirections : 1;
+  std::vector<G4double> inverseCosines;
+  for (G4int i=0; i<nDirections; i++)
+    inverseCosines.push_back(1./(1.-(1.-minCosTheta)*(i+0.5)/nDirections));
+
+  std::vector<G4double> transmissions(nDirections);
+  for (size_t i=0; i<energies.size(); i++) {
+    if (probabilities[i]<=0.) continue;
+    G4int bin = std::floor((energies[i]-minEnergy)/(maxEnergy-minEnergy)*nBins);
+    if (bin<0 || bin>=nBins) continue;
+    G4double intensity = nEvents*probabilities[i];
+    spectra["primary"][bin] += intensity;
+
+    std::fill(transmissions.begin(), transmissions.end(), 1.);
+    for (size_t layer=0; layer<fTables.size(); layer++) {
+      G4double opticalDepth = fTables[layer]->GetAttenuation(energies[i]*keV)*fThicknesses[layer];
+      G4double transmission = 0.;
+      for (G4int direction=0; direction<nDirections; direction++) {
+        transmissions[direction] *= std::exp(-opticalDepth*inverseCosines[direction]);
+        transmission += transmissions[direction];
+      }
+      if (fBranchNames[layer]!="") spectra[fBranchNames[layer]][bin] += intensity*transmission/nDirections;
+    }
+  }
+  return spectra;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
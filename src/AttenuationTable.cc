@@ -0,0 +1,43 @@
+/// \file AttenuationTable.cc
+/// \brief Implementation of the AttenuationTable class
+
+#include "AttenuationTable.hh"
+
+#include "G4EmCalculator.hh"
+#include "G4Gamma.hh"
+#include "G4Material.hh"
+
+#include <algorithm>
+#include <cmath>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+AttenuationTable::AttenuationTable(const G4Material *material, std::vector<G4String> processes,
+                                   G4double minEnergy, G4double maxEnergy, G4int nBins) {
+  G4EmCalculator calculator;
+  const G4ParticleDefinition *gamma = G4Gamma::Definition();
+  G4double logMin = std::log(minEnergy), logMax = std::log(maxEnergy);
+  for (G4int i=0; i<=nBins; i++) {
+    G4double logEnergy = logMin+(logMax-logMin)*i/nBins;
+    G4double attenuation = 0.;
+    for (G4String process:processes)
+      attenuation += calculator.ComputeCrossSectionPerVolume(std::exp(logEnergy), gamma, process, material);
+    fLogEnergies.push_back(logEnergy);
+    // floor keeps the logarithm finite where no process contributes
+    fLogAttenuations.push_back(std::log(std::max(attenuation, 1e-30/CLHEP::mm)));
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double AttenuationTable::GetAttenuation(G4double energy) const {
+  G4double logEnergy = std::log(energy);
+  if (logEnergy<=fLogEnergies.front()) return std::exp(fLogAttenuations.front());
+  if (logEnergy>=fLogEnergies.back()) return std::exp(fLogAttenuations.back());
+
+  size_t i = std::upper_bound(fLogEnergies.begin(), fLogEnergies.end(), logEnergy)-fLogEnergies.begin();
+  G4double t = (logEnergy-fLogEnergies[i-1])/(fLogEnergies[i]-fLogEnergies[i-1]);
+  return std::exp(fLogAttenuations[i-1]+t*(fLogAttenuations[i]-fLogAttenuations[i-1]));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
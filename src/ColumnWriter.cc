@@ -0,0 +1,70 @@
+/// \file ColumnWriter.cc
+/// \brief Implementation of the ColumnWriter class
+
+#include "ColumnWriter.hh"
+
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__!=__ORDER_LITTLE_ENDIAN__
+#error "column files are written in the byte order of the host, little-endian expected"
+#endif
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ColumnWriter::ColumnWriter(G4String directory, G4String tree, const std::vector<G4String> &columns, G4int thread) {
+  mkdir(directory.c_str(), 0755);
+  G4String suffix = thread>=0 ? ".t"+std::to_string(thread)+".col" : G4String(".col");
+  for (G4String column:columns) {
+    G4String path = directory+"/"+tree+"."+column+suffix;
+    std::ofstream *file = new std::ofstream(path, std::ios::binary | std::ios::trunc);
+    if (!*file) {
+      G4ExceptionDescription msg;
+      msg << "Cannot write column file " << path;
+      G4Exception("ColumnWriter::ColumnWriter()", "MyCode0050", FatalException, msg);
+    }
+
+    char header[kHeaderSize] = {};
+    uint32_t sizes[2] = {kHeaderSize, sizeof(G4double)};
+    std::memcpy(header, "GEMCOLS1", 8);
+    std::memcpy(header+8, sizes, sizeof(sizes));
+    std::strncpy(header+24, column.c_str(), 31);
+    file->write(header, kHeaderSize);
+    fFiles.push_back(file);
+  }
+  fBuffer.reserve(kBufferRows*fFiles.size());
+  fColumn.reserve(kBufferRows);
+}
+
+ColumnWriter::~ColumnWriter() {
+  Close();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnWriter::WriteBuffer() {
+  size_t nColumns = fFiles.size();
+  size_t nRows = fBuffer.size()/nColumns;
+  for (size_t column=0; column<nColumns; column++) {
+    fColumn.clear();
+    for (size_t row=0; row<nRows; row++) fColumn.push_back(fBuffer[row*nColumns+column]);
+    fFiles[column]->write((const char *)fColumn.data(), nRows*sizeof(G4double));
+  }
+  fRows += nRows;
+  fBuffer.clear();
+}
+
+void ColumnWriter::Close() {
+  if (fFiles.empty()) return;
+  WriteBuffer();
+  for (std::ofstream *file:fFiles) {
+    file->seekp(16);
+    file->write((const char *)&fRows, sizeof(fRows));
+    delete file; // closes it
+  }
+  fFiles.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
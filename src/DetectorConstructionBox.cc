@@ -28,6 +28,7 @@
 /// \brief Implementation of the DetectorConstructionBox class
 
 #include "DetectorConstructionBox.hh"
+#include "StartupProfile.hh"
 
 #include "G4Material.hh"
 #include "G4String.hh"
@@ -45,11 +46,17 @@
 #include "G4SystemOfUnits.hh"
 #include "G4VisAttributes.hh"
 #include "G4Colour.hh"
+#include "G4Region.hh"
+#include "G4ProductionCuts.hh"
+#include "G4ProductionCutsTable.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4IStore.hh"
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-DetectorConstructionBox::DetectorConstructionBox(std::vector<std::pair<G4String, G4double>> materialLayers):G4VUserDetectorConstruction() {
+DetectorConstructionBox::DetectorConstructionBox(LayerStack materialLayers, G4bool importanceBiasing):G4VUserDetectorConstruction() {
   this->materialLayers = materialLayers;
+  fImportanceBiasing = importanceBiasing;
   colorMap["copper"] = G4Colour(0, 0, .8, 1);
   colorMap["kapton"] = G4Colour(.8, 0, 0, 1);
   colorMap["argon"] = G4Colour(1, 0, 0, 1);
@@ -65,6 +72,7 @@ DetectorConstructionBox::~DetectorConstructionBox()
 
 G4VPhysicalVolume* DetectorConstructionBox::Construct()
 {
+  StartupProfile::Scope profileScope("geometry");
   ConstructMaterials();
 
   G4Element* Cl = new G4Element("Chlorine", "Cl", 17., 35.5*g/mole);
@@ -99,6 +107,7 @@ G4VPhysicalVolume* DetectorConstructionBox::Construct()
     materialMap["pvc"] = pvc;
     materialMap["argon"] = argon;
     materialMap["fr4"] = fr4;
+    materialMap["air"] = G4NistManager::Instance()->FindOrBuildMaterial("G4_AIR"); // slabs of the transfer matrices
   }
   
   // Get nist material manager
@@ -124,8 +133,8 @@ G4VPhysicalVolume* DetectorConstructionBox::Construct()
   G4double envSizeXY = 250*cm;
   G4double envSizeZ = 250*cm;
 
-  for (auto materialNameThicknessPair:materialLayers) {
-    envSizeZ += materialNameThicknessPair.second*1.5;
+  for (auto layer:materialLayers) {
+    envSizeZ += layer.thickness*1.5;
   }
 
   //sourceToChamberZ+copperWindowThickness+gasThickness+driftFr4Thickness+driftCopperThickness+2*driftGapThickness;
@@ -156,11 +165,18 @@ G4VPhysicalVolume* DetectorConstructionBox::Construct()
   G4double layerPosition = -0.15*envSizeZ;
   //G4double layerPosition = 0.;
   G4int materialIndex = 0;
-  for (auto materialNameThicknessPair:materialLayers) { // add all material layers
-    G4String materialName = materialNameThicknessPair.first;
-    G4double materialThickness = materialNameThicknessPair.second*mm;
+  G4int gapIndex = 0;
+  for (auto layer:materialLayers) { // add all material layers
+    G4String materialName = layer.material;
+    G4double materialThickness = layer.thickness*mm;
 
     if (materialName==G4String("vacuum")) { // just leave empty space 
+      if (fImportanceBiasing) { // unless it needs a cell for its importance
+        gapIndex++;
+        G4Box *gapBox = new G4Box(G4String("BoxGap")+std::to_string(gapIndex), 0.5*chamberSizeXY, 0.5*chamberSizeXY, 0.5*materialThickness);
+        G4LogicalVolume *gapLogical = new G4LogicalVolume(gapBox, envMaterial, G4String("LogicalGap")+std::to_string(gapIndex));
+        new G4PVPlacement(0, G4ThreeVector(0.,0.,layerPosition+0.5*materialThickness), gapLogical, G4String("PhysicalGap")+std::to_string(gapIndex), logicEnv, false, 0, checkOverlaps);
+      }
       layerPosition += materialThickness;
       continue;
     }
@@ -177,6 +193,18 @@ G4VPhysicalVolume* DetectorConstructionBox::Construct()
     logical->SetVisAttributes(visAttributes);
     new G4PVPlacement(0, G4ThreeVector(0.,0.,layerPosition), logical, physicalName, logicEnv, false, 0, checkOverlaps);
 
+    // every layer is a region, with its own cuts if requested;
+    // deexcitation and msc are configured by the physics list
+    G4Region *region = new G4Region(GetLayerRegionName(layer, materialIndex));
+    region->AddRootLogicalVolume(logical);
+    if (layer.cut>0) {
+      G4ProductionCuts *cuts = new G4ProductionCuts();
+      cuts->SetProductionCut(layer.cut*mm);
+      region->SetProductionCuts(cuts);
+    } else {
+      region->SetProductionCuts(G4ProductionCutsTable::GetProductionCutsTable()->GetDefaultProductionCuts());
+    }
+
     layerPosition += 0.5*materialThickness;
   }
 
@@ -270,6 +298,33 @@ G4Material *DetectorConstructionBox::createFR4() {
   return fr4;
 }
 
+void DetectorConstructionBox::ConstructSDandField() {
+  if (!fImportanceBiasing) return;
+
+  // cells of the layers and of the placed vacuum gaps, the gas gap
+  // inherits the importance of the last layer; everything else is 1
+  std::map<G4String, G4double> importanceMap;
+  G4int materialIndex = 0, gapIndex = 0;
+  G4double lastImportance = 1.;
+  for (auto layer:materialLayers) {
+    if (layer.material==G4String("vacuum")) importanceMap[G4String("PhysicalGap")+std::to_string(++gapIndex)] = layer.importance;
+    else {
+      materialIndex++;
+      importanceMap[G4String("Physical")+layer.material+std::to_string(materialIndex)] = layer.importance;
+    }
+    lastImportance = layer.importance;
+  }
+  importanceMap["DriftGapPhysical"] = lastImportance;
+
+  G4IStore *importanceStore = G4IStore::GetInstance();
+  for (G4VPhysicalVolume *volume:*G4PhysicalVolumeStore::GetInstance()) {
+    G4double importance = importanceMap.count(volume->GetName()) ? importanceMap[volume->GetName()] : 1.;
+    importanceStore->AddImportanceGeometryCell(importance, *volume, volume->GetCopyNo());
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 void DetectorConstructionBox::ConstructMaterials() {
    auto nistManager = G4NistManager::Instance();
 
@@ -283,6 +338,14 @@ void DetectorConstructionBox::ConstructMaterials() {
    // nistManager->BuildMaterialWithNewDensity("B5_Ar","G4_Ar",density);
    // !! cases segmentation fault
 
+   // Ar/CO2 70/30 by volume as in HEED, not placed: only used for
+   // the gas attenuation coefficient of the forced conversion
+   if (!G4Material::GetMaterial("ArCO2", false)) {
+     G4Material *arCO2 = new G4Material("ArCO2", 1.716*mg/cm3, 2, kStateGas, 293.15*kelvin, 1.*atmosphere);
+     arCO2->AddMaterial(nistManager->FindOrBuildMaterial("G4_Ar"), 0.679);
+     arCO2->AddMaterial(nistManager->FindOrBuildMaterial("G4_CARBON_DIOXIDE"), 0.321);
+   }
+
    // Scintillator
    // (PolyVinylToluene, C_9H_10)
    nistManager->FindOrBuildMaterial("G4_PLASTIC_SC_VINYLTOLUENE");
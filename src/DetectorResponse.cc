@@ -0,0 +1,103 @@
+/// \file DetectorResponse.cc
+/// \brief Implementation of the DetectorResponse functions
+
+#include "DetectorResponse.hh"
+#include "ResponseMatrix.hh"
+#include "RunAction.hh"
+#include "RunConfiguration.hh"
+#include "PrimaryGeneratorAction.hh"
+
+#include "G4RunManager.hh"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace {
+  // precedes the smallest cos(theta) of the scan in the description
+  const char *kConeLabel = "cos(theta) from ";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void BuildDetectorResponse(G4String path, G4int nBins, G4double minEnergy, G4double maxEnergy, G4int eventsPerEnergy) {
+  RunConfiguration *configuration = RunConfiguration::Instance();
+  // monoenergetic photons in the cone of the source the matrix is for
+  G4double minCosTheta = PrimaryGeneratorAction::GetMinCosTheta(configuration->GetSource(), configuration->GetSpectrumPath());
+  configuration->SetSource("mono");
+  configuration->SetMonoMinCosTheta(minCosTheta);
+  G4RunManager *runManager = G4RunManager::GetRunManager();
+  const RunAction *runAction = (const RunAction *)runManager->GetUserRunAction();
+
+  ResponseMatrix matrix;
+  // whole events of several photons each when so configured
+  G4int photonsPerEvent = configuration->GetPhotonsPerEvent();
+  G4int nEvents = (eventsPerEnergy+photonsPerEvent-1)/photonsPerEvent;
+  auto start = std::chrono::steady_clock::now();
+  for (G4int in=0; in<nBins; in++) {
+    configuration->SetMonoEnergy(minEnergy+(in+0.5)*(maxEnergy-minEnergy)/nBins);
+    runManager->BeamOn(nEvents);
+
+    TH1D *histogram = runAction->GetHistograms().at("primaries");
+    G4int nOut = histogram->GetNbinsX();
+    if (in==0) matrix = ResponseMatrix(nBins, minEnergy, maxEnergy, nOut, histogram->GetXaxis()->GetXmin(), histogram->GetXaxis()->GetXmax());
+    std::vector<double> column(nOut);
+    for (G4int out=0; out<nOut; out++) column[out] = histogram->GetBinContent(out+1)/(nEvents*photonsPerEvent);
+    matrix.SetColumn(in, column);
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now()-start;
+
+  std::ostringstream description;
+  description << "# photon energy (keV) to conversion primaries, " << eventsPerEnergy << " photons per energy, "
+              << kConeLabel << minCosTheta;
+  if (configuration->GetForcedConversion()) description << ", forced conversion";
+  matrix.SetDescription(description.str());
+  if (!matrix.Write(path)) {
+    G4ExceptionDescription msg;
+    msg << "Cannot write detector response " << path;
+    G4Exception("BuildDetectorResponse()", "MyCode0041", FatalException, msg);
+  }
+  G4cout << "Detector response written to " << path << " in " << elapsed.count() << " s" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void FoldDetectorResponse(G4String responsePath, G4String source, G4String spectrumPath, G4String outPath) {
+  ResponseMatrix matrix;
+  if (!matrix.Read(responsePath)) {
+    G4ExceptionDescription msg;
+    msg << "Cannot read detector response " << responsePath;
+    G4Exception("FoldDetectorResponse()", "MyCode0041", FatalException, msg);
+    return;
+  }
+
+  // a matrix scanned in another cone has other path lengths in the layers
+  G4double minCosTheta = PrimaryGeneratorAction::GetMinCosTheta(source, spectrumPath);
+  size_t conePosition = matrix.GetDescription().find(kConeLabel);
+  G4double matrixMinCosTheta = conePosition==std::string::npos ? 1. :
+    std::atof(matrix.GetDescription().c_str()+conePosition+std::string(kConeLabel).size());
+  if (std::abs(matrixMinCosTheta-minCosTheta)>1e-5)
+    G4cout << "Warning: " << responsePath << " was built for cos(theta) from " << matrixMinCosTheta
+           << ", source " << source << " has " << minCosTheta << G4endl;
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<G4double> energies, probabilities;
+  PrimaryGeneratorAction::GetSourceSpectrum(source, spectrumPath, energies, probabilities);
+  std::vector<double> primaries = matrix.Apply(matrix.Bin(energies, probabilities));
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now()-start;
+
+  // per source photon, in the histogram layout of the run summary
+  std::ofstream outFile(outPath);
+  outFile << std::setprecision(10);
+  outFile << "{\n  \"seconds\": " << elapsed.count() << ",\n  \"histograms\": {\n";
+  outFile << "    \"primaries\": {\"min\": " << matrix.GetOutMin() << ", \"max\": " << matrix.GetOutMax() << ", \"contents\": [";
+  for (size_t bin=0; bin<primaries.size(); bin++) outFile << (bin>0 ? ", " : "") << primaries[bin];
+  outFile << "]}\n  }\n}\n";
+  G4cout << "Folded " << spectrumPath << " into " << outPath << " in " << elapsed.count()*1e3 << " ms" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
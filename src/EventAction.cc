@@ -31,12 +31,19 @@
 
 #include "EventAction.hh"
 #include "RunAction.hh"
+#include "StartupProfile.hh"
+#include "RunConfiguration.hh"
+#include "Logger.hh"
 
 #include "G4ThreeVector.hh"
 #include "G4String.hh"
 #include "G4Event.hh"
 #include "G4RunManager.hh"
+#include "G4Threading.hh"
+#include "G4Run.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Track.hh"
+#include "G4ParticleDefinition.hh"
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -52,53 +59,122 @@ EventAction::~EventAction() {}
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 void EventAction::BeginOfEventAction(const G4Event *event) {
+  if (event->GetEventID()==0) StartupProfile::Instance()->Begin("first event");
   if (volumeBranchNames.size()==0) {
     volumeBranchNames.push_back(G4String("primary"));
     G4int materialIndex = 0;
-    for (auto materialNameThicknessPair:fLayersMap) {
-      G4String materialName = materialNameThicknessPair.first;
+    for (auto layer:fLayersMap) {
+      G4String materialName = layer.material;
       if (materialName==G4String("vacuum")) continue;
       materialIndex++;
       volumeBranchNames.push_back(G4String(materialName+std::to_string(materialIndex)));
     }
   }
 
-  for (G4String volumeBranchName:this->volumeBranchNames) this->hitEnergies[volumeBranchName] = new G4DataVector();
-  this->hitPositions[volumeBranchNames[volumeBranchNames.size()-1]] = new vector<G4ThreeVector>();
-  this->hitMomenta[volumeBranchNames[volumeBranchNames.size()-1]] = new vector<G4ThreeVector>();
-
-  this->electrons = new vector<particle>(0);
-  this->photons = new vector<particle>(0);
+  // records are cleared rather than reallocated, events reuse their capacity
+  fPrimaryRecords.resize(RunConfiguration::Instance()->GetPhotonsPerEvent());
+  for (primaryRecord &record:fPrimaryRecords) {
+    for (G4String volumeBranchName:this->volumeBranchNames) {
+      record.hitEnergies[volumeBranchName].clear();
+      record.hitWeights[volumeBranchName].clear();
+    }
+    record.photons.clear();
+    record.electrons.clear();
+    for (auto &scorePair:record.sensitivityScores) scorePair.second = 0.;
+  }
+  fTrackPrimaries.assign(1, 0);
 
   G4int eventID = event->GetEventID();
-  if (eventID%10000 == 0) G4cout << eventID << "/" << runAction->nOfEvents << "\t\t" << G4endl;
+  if (eventID%10000 == 0) LOG_PROGRESS(eventID << "/" << runAction->nOfEvents);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 void EventAction::EndOfEventAction(const G4Event* event) {
-  G4String volumeName;
-  G4DataVector *volumeHitEnergies;
-  for (auto it=hitEnergies.begin(); it!=hitEnergies.end(); it++) {
-    volumeName = it->first;
-    volumeHitEnergies = it->second;
-    for (G4double energy:*volumeHitEnergies) this->runAction->FillNtuples(volumeName, energy);
+  // every primary photon is filled as an event of its own
+  for (primaryRecord &record:fPrimaryRecords) {
+    for (auto it=record.hitEnergies.begin(); it!=record.hitEnergies.end(); it++) {
+      G4String volumeName = it->first;
+      G4DataVector &volumeHitWeights = record.hitWeights[volumeName];
+      for (size_t i=0; i<it->second.size(); i++)
+        this->runAction->FillNtuples(volumeName, it->second.at(i), volumeHitWeights.at(i));
+    }
+    this->photons = &record.photons;
+    this->electrons = &record.electrons;
+    // the conversions of this photon are weighted with its scores
+    if (RunConfiguration::Instance()->GetSensitivity()) this->runAction->SetSensitivityScores(record.sensitivityScores);
+    if (RunConfiguration::Instance()->GetParticleConversions()) {
+      this->FillParticleConversions();
+    } else if (RunConfiguration::Instance()->GetForcedConversion()) {
+      this->FillForcedConversions();
+    } else {
+      int primaries = this->TransportPhotons()+this->TransportElectrons();
+      //int primaries = this->TransportPhotons();
+      if (primaries>20) this->runAction->FillNtuples("conversion", primaries/gasIonizationEnergy, primaries);
+    }
   }
-  int primaries = this->TransportPhotons()+this->TransportElectrons();
-  //int primaries = this->TransportPhotons();
-  if (primaries>20) this->runAction->FillNtuples("conversion", primaries/gasIonizationEnergy, primaries);
+  if (event->GetEventID()==0) StartupProfile::Instance()->End("first event");
+  if (runAction->GetStatusCounters()) runAction->GetStatusCounters()->AddEvent();
+
+  if (!fRecordSlowEvents) return;
+  fRecordSlowEvents = false; // until the next primary generation starts the clock
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now()-fEventStart;
+  SlowEventList &slowEvents = runAction->GetSlowEvents();
+  if (elapsed.count()<=slowEvents.GetThreshold()) return;
+  RunConfiguration *configuration = RunConfiguration::Instance();
+  SlowEvent slowEvent;
+  slowEvent.runID = G4RunManager::GetRunManager()->GetCurrentRun()->GetRunID();
+  slowEvent.eventID = event->GetEventID();
+  slowEvent.seconds = elapsed.count();
+  slowEvent.steps = fEventSteps;
+  for (auto trackPair:fEventTracks) if (trackPair.second>0) slowEvent.tracks[trackPair.first->GetParticleName()] = trackPair.second;
+  slowEvent.source = configuration->GetSource();
+  slowEvent.spectrumPath = configuration->GetSpectrumPath();
+  slowEvent.tubeVoltage = configuration->GetTubeVoltage();
+  slowEvent.spotPath = configuration->GetSpotPath();
+  slowEvent.photonsPerEvent = configuration->GetPhotonsPerEvent();
+  slowEvent.forcedConversion = configuration->GetForcedConversion();
+  slowEvent.quasiRandom = configuration->GetQuasiRandom();
+  slowEvent.quasiRandomSeed = configuration->GetQuasiRandomSeed();
+  slowEvent.importanceBiasing = configuration->GetImportanceBiasing();
+  if (G4Threading::IsMultithreadedApplication()) slowEvent.threads = G4Threading::GetNumberOfRunningWorkerThreads();
+  slowEvent.engineState = fEngineState;
+  slowEvents.Add(slowEvent);
+}
+
+void EventAction::StartSlowEventClock(const G4String &engineState) {
+  fRecordSlowEvents = true;
+  fEngineState = engineState;
+  fEventSteps = 0;
+  for (auto &trackPair:fEventTracks) trackPair.second = 0;
+  fEventStart = std::chrono::steady_clock::now();
 }
 
-void EventAction::AddHit(G4String volume, G4double energy) {
-  this->hitEnergies[volume]->push_back(energy);
+void EventAction::CountStep(const G4Track *track) {
+  if (!fRecordSlowEvents) return;
+  fEventSteps++;
+  if (track->GetCurrentStepNumber()==1) fEventTracks[track->GetParticleDefinition()]++;
 }
 
-void EventAction::AddPhoton(G4double energy, G4ThreeVector position, G4ThreeVector momentum) {
+G4int EventAction::RegisterTrack(G4int trackID, G4int parentID) {
+  if (trackID>=(G4int)fTrackPrimaries.size()) fTrackPrimaries.resize(2*trackID, 0);
+  // parents are always tracked before their secondaries
+  fTrackPrimaries[trackID] = parentID==0 ? trackID-1 : fTrackPrimaries[parentID];
+  return fTrackPrimaries[trackID];
+}
+
+void EventAction::AddHit(G4String volume, G4double energy, G4double weight, G4int primary) {
+  fPrimaryRecords[primary].hitEnergies[volume].push_back(energy);
+  fPrimaryRecords[primary].hitWeights[volume].push_back(weight);
+}
+
+void EventAction::AddPhoton(G4double energy, G4ThreeVector position, G4ThreeVector momentum, G4double weight, G4int primary) {
   particle photon;
   photon.energy = energy;
   photon.position = position;
   photon.momentum = momentum;
-  photons->push_back(photon);
+  photon.weight = weight;
+  fPrimaryRecords[primary].photons.push_back(photon);
 }
 
 int EventAction::TransportPhotons() {
@@ -113,12 +189,13 @@ int EventAction::TransportPhotons() {
   return primaries;
 }
 
-void EventAction::AddElectron(G4double energy, G4ThreeVector position, G4ThreeVector momentum) {
+void EventAction::AddElectron(G4double energy, G4ThreeVector position, G4ThreeVector momentum, G4double weight, G4int primary) {
   particle electron;
   electron.energy = energy;
   electron.position = position;
   electron.momentum = momentum;
-  electrons->push_back(electron);
+  electron.weight = weight;
+  fPrimaryRecords[primary].electrons.push_back(electron);
 }
 
 int EventAction::TransportElectrons() {
@@ -134,3 +211,61 @@ int EventAction::TransportElectrons() {
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EventAction::FillForcedConversions() {
+  int electronPrimaries = this->TransportElectrons();
+  int nPhotons = photons->size();
+  if (nPhotons>maxForcedPhotons) { // too many outcomes, fall back to analog transport
+    int primaries = this->TransportPhotons()+electronPrimaries;
+    if (primaries>20) this->runAction->FillNtuples("conversion", primaries/gasIonizationEnergy, primaries);
+    return;
+  }
+
+  vector<int> photonPrimaries(nPhotons);
+  vector<G4double> probabilities(nPhotons), conversionWeights(nPhotons);
+  for (int i=0; i<nPhotons; i++) {
+    photonPrimaries[i] = runAction->heedSimulation->ForcePhotonConversion(this,
+      photons->at(i).energy,
+      photons->at(i).position,
+      photons->at(i).momentum,
+      probabilities[i],
+      conversionWeights[i]
+    );
+  }
+
+  // every subset of converting photons is one weighted outcome of the event,
+  // weighted by the conversion weights and non-conversion probabilities
+  // (their sum is one unless some forced trials ran out)
+  for (unsigned int subset=0; subset<(1u<<nPhotons); subset++) {
+    G4double weight = 1.;
+    int primaries = electronPrimaries;
+    for (int i=0; i<nPhotons; i++) {
+      if (subset&(1u<<i)) {
+        weight *= conversionWeights[i];
+        primaries += photonPrimaries[i];
+      } else {
+        weight *= 1.-probabilities[i];
+      }
+    }
+    if (weight>0. && primaries>20) this->runAction->FillNtuples("conversion", primaries/gasIonizationEnergy, primaries, weight);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EventAction::FillParticleConversions() {
+  G4bool forced = RunConfiguration::Instance()->GetForcedConversion();
+  for (auto photon:*photons) {
+    G4double probability, conversionWeight = 1.;
+    int primaries;
+    if (forced) primaries = runAction->heedSimulation->ForcePhotonConversion(this, photon.energy, photon.position, photon.momentum, probability, conversionWeight);
+    else primaries = runAction->heedSimulation->TransportPhoton(this, photon.energy, photon.position, photon.momentum);
+    if (primaries>20) this->runAction->FillNtuples("conversion", primaries/gasIonizationEnergy, primaries, photon.weight*conversionWeight);
+  }
+  for (auto electron:*electrons) {
+    int primaries = runAction->heedSimulation->TransportElectron(this, electron.energy, electron.position, electron.momentum);
+    if (primaries>20) this->runAction->FillNtuples("conversion", primaries/gasIonizationEnergy, primaries, electron.weight);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,15 @@
+/// \file ExceptionHandler.cc
+/// \brief Implementation of the ExceptionHandler class
+
+#include "ExceptionHandler.hh"
+#include "Logger.hh"
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool ExceptionHandler::Notify(const char* originOfException, const char* exceptionCode,
+    G4ExceptionSeverity severity, const char* description) {
+  Logger::Instance()->Flush();
+  return G4ExceptionHandler::Notify(originOfException, exceptionCode, severity, description);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
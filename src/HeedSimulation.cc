@@ -31,6 +31,12 @@
 #include "HeedSimulation.hh"
 #include "EventAction.hh"
 #include "RunAction.hh"
+#include "StartupProfile.hh"
+
+#include "G4Material.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
 
 using namespace Garfield;
 using namespace std;
@@ -43,10 +49,6 @@ HeedSimulation::HeedSimulation(RunAction *runAction) {
   gas->SetTemperature(293.15);
   gas->SetPressure(AtmosphericPressure);
 
-  // gas gap sides in cm
-  const double length = 10;
-  const double width = 10;
-  const double depth = 0.3;
   SolidBox *box = new SolidBox(0., 0., 0., length/2., width/2., depth/2.);
   GeometrySimple *geo = new GeometrySimple();
   geo->AddSolid(box, gas);
@@ -75,7 +77,12 @@ int HeedSimulation::TransportPhoton(EventAction *eventAction, G4double energy, G
   const double dz = momentum.getZ();
   const double e0 = energy*1.e3;
   int primaries = 0;
+  // HEED sets up its cross sections on the first transported track
+  if (!tracked) StartupProfile::Instance()->Begin("HEED first track");
+  INSTRUMENT(Instrumentation::Scope instrumentationScope(runAction->GetInstrumentation(), Instrumentation::kHeedTransport));
   this->track->TransportPhoton(x0, y0, z0, t0, e0, dx, dy, dz, primaries);
+  if (!tracked) StartupProfile::Instance()->End("HEED first track");
+  tracked = true;
   return primaries;
   //this->runAction->FillNtuples("conversion", primaries/gasIonizationEnergy, primaries);
 }
@@ -95,7 +102,50 @@ int HeedSimulation::TransportElectron(EventAction *eventAction, G4double energy,
   int nc = 0;
   while (this->track->GetCluster(xc, yc, zc, tc, nc, ec, extra)) primaries += nc;*/
   int primaries = 0;
+  if (!tracked) StartupProfile::Instance()->Begin("HEED first track");
+  INSTRUMENT(Instrumentation::Scope instrumentationScope(runAction->GetInstrumentation(), Instrumentation::kHeedTransport));
   this->track->TransportDeltaElectron(x0, y0, z0, t0, e0, dx, dy, dz, primaries);
+  if (!tracked) StartupProfile::Instance()->End("HEED first track");
+  tracked = true;
   return primaries;
   //this->runAction->FillNtuples("conversion", primaries/gasIonizationEnergy, primaries);
 }
+
+int HeedSimulation::ForcePhotonConversion(EventAction *eventAction, G4double energy, G4ThreeVector position, G4ThreeVector momentum,
+    G4double &probability, G4double &conversionWeight) {
+  if (!gasAttenuation) gasAttenuation = new AttenuationTable(G4Material::GetMaterial("ArCO2"), {"phot", "compt"});
+
+  // path to the first face of the gas box, photons start on its lower face
+  const double x0 = position.getX()*1e-1;
+  const double y0 = position.getY()*1e-1;
+  const double dx = momentum.getX();
+  const double dy = momentum.getY();
+  const double dz = momentum.getZ();
+  double path = 0.;
+  if (dz>0) {
+    path = depth/dz;
+    if (dx!=0) path = std::min(path, ((dx>0 ? 0.5 : -0.5)*length-x0)/dx);
+    if (dy!=0) path = std::min(path, ((dy>0 ? 0.5 : -0.5)*width-y0)/dy);
+  }
+  G4double opticalDepth = gasAttenuation->GetAttenuation(energy*keV)*std::max(path, 0.)*cm;
+  probability = 1.-std::exp(-opticalDepth);
+  conversionWeight = 0.;
+  if (probability<=0.) return 0;
+
+  // HEED samples the conversion point itself, so keep the photons that
+  // leave electrons in the gas; the rare conversions without ionisation
+  // (fluorescence escaping with all the energy) are dropped with them.
+  // With a HEED conversion probability equal to the analog one, a photon
+  // converts within the trials with 1-exp(-trials*depth); dividing by it
+  // keeps the estimate unbiased when the trials run out
+  int primaries = 0;
+  for (int trial=0; trial<maxForcedTrials && primaries==0; trial++)
+    primaries = TransportPhoton(eventAction, energy, position, momentum);
+  runAction->CountForcedConversion(primaries>0);
+  if (primaries>0) conversionWeight = probability/-std::expm1(-maxForcedTrials*opticalDepth);
+  return primaries;
+}
+
+void HeedSimulation::SeedRandom(unsigned int seed) {
+  randomEngine.Seed(seed);
+}
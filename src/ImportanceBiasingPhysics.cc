@@ -0,0 +1,36 @@
+/// \file ImportanceBiasingPhysics.cc
+/// \brief Implementation of the ImportanceBiasingPhysics class
+
+#include "ImportanceBiasingPhysics.hh"
+
+#include "G4GeometrySampler.hh"
+#include "G4IStore.hh"
+#include "G4TransportationManager.hh"
+#include "G4Navigator.hh"
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4ThreadLocal G4GeometrySampler *ImportanceBiasingPhysics::fSampler = 0;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ImportanceBiasingPhysics::ImportanceBiasingPhysics(G4String particleName):G4VPhysicsConstructor("ImportanceBiasingPhysics") {
+  fParticleName = particleName;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ImportanceBiasingPhysics::~ImportanceBiasingPhysics() {}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ImportanceBiasingPhysics::ConstructProcess() {
+  if (fSampler) return;
+  G4VPhysicalVolume *world = G4TransportationManager::GetTransportationManager()->GetNavigatorForTracking()->GetWorldVolume();
+  fSampler = new G4GeometrySampler(world, fParticleName);
+  fSampler->SetParallel(false);
+  fSampler->PrepareImportanceSampling(G4IStore::GetInstance(), 0);
+  fSampler->Configure();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,86 @@
+/// \file Instrumentation.cc
+/// \brief Implementation of the Instrumentation class
+
+#include "Instrumentation.hh"
+
+#include "G4LogicalVolume.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4Threading.hh"
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const char *Instrumentation::GetSectionName(Section section) {
+  static const char *names[kNSections] = {"stepping_action", "heed_transport", "fill_ntuples"};
+  return names[section];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Instrumentation::BeginRun() {
+  for (auto &volumeSteps:fVolumeSteps) volumeSteps.second = 0;
+  for (auto &particleSteps:fParticleSteps) particleSteps.second = 0;
+  for (Timer &timer:fTimers) timer = Timer();
+  fThreadRates.clear();
+  fRunStart = Clock::now();
+}
+
+void Instrumentation::EndRun(G4int nEvents) {
+  std::chrono::duration<double> elapsed = Clock::now()-fRunStart;
+  fThreadRates.push_back({G4Threading::G4GetThreadId(), nEvents, elapsed.count()});
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Instrumentation::Merge(const Instrumentation &worker) {
+  for (auto volumeSteps:worker.fVolumeSteps) fVolumeSteps[volumeSteps.first] += volumeSteps.second;
+  for (auto particleSteps:worker.fParticleSteps) fParticleSteps[particleSteps.first] += particleSteps.second;
+  for (G4int section=0; section<kNSections; section++) {
+    fTimers[section].calls += worker.fTimers[section].calls;
+    fTimers[section].timedCalls += worker.fTimers[section].timedCalls;
+    fTimers[section].seconds += worker.fTimers[section].seconds;
+  }
+  fThreadRates.insert(fThreadRates.end(), worker.fThreadRates.begin(), worker.fThreadRates.end());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Instrumentation::WriteJson(std::ostream &out, G4String indent) const {
+  // logical volumes with the same name, if any, are added together
+  std::map<G4String, G4long> volumeSteps, particleSteps;
+  for (auto steps:fVolumeSteps) if (steps.second>0) volumeSteps[steps.first->GetName()] += steps.second;
+  for (auto steps:fParticleSteps) if (steps.second>0) particleSteps[steps.first->GetParticleName()] += steps.second;
+
+  out << "{\n" << indent << "  \"steps_per_volume\": {";
+  G4String separator = "";
+  for (auto steps:volumeSteps) {
+    out << separator << "\n" << indent << "    \"" << steps.first << "\": " << steps.second;
+    separator = ",";
+  }
+  out << "\n" << indent << "  },\n" << indent << "  \"steps_per_particle\": {";
+  separator = "";
+  for (auto steps:particleSteps) {
+    out << separator << "\n" << indent << "    \"" << steps.first << "\": " << steps.second;
+    separator = ",";
+  }
+
+  // sampled sections are extrapolated to all their calls
+  out << "\n" << indent << "  },\n" << indent << "  \"sections\": {";
+  separator = "";
+  for (G4int section=0; section<kNSections; section++) {
+    const Timer &timer = fTimers[section];
+    G4double seconds = timer.timedCalls>0 ? timer.seconds*timer.calls/timer.timedCalls : 0.;
+    out << separator << "\n" << indent << "    \"" << GetSectionName((Section)section) << "\": {";
+    out << "\"calls\": " << timer.calls << ", \"timed_calls\": " << timer.timedCalls << ", \"seconds\": " << seconds << "}";
+    separator = ",";
+  }
+  out << "\n" << indent << "  },\n" << indent << "  \"threads\": [";
+  separator = "";
+  for (const ThreadRate &rate:fThreadRates) {
+    out << separator << "\n" << indent << "    {\"thread\": " << rate.thread << ", \"events\": " << rate.events;
+    out << ", \"seconds\": " << rate.seconds << ", \"events_per_second\": " << (rate.seconds>0 ? rate.events/rate.seconds : 0.) << "}";
+    separator = ",";
+  }
+  out << "\n" << indent << "  ]\n" << indent << "}";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,186 @@
+/// \file JobServer.cc
+/// \brief Implementation of the JobServer class
+
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+#include <poll.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "JobServer.hh"
+#include "RunAction.hh"
+#include "RunConfiguration.hh"
+#include "PrimaryGeneratorAction.hh"
+
+#include "G4RunManager.hh"
+#include "Randomize.hh"
+
+const G4int JobServer::kTimeoutSeconds;
+const size_t JobServer::kMaxRequestSize;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+JobServer::JobServer(G4String socketPath) {
+  fSocketPath = socketPath;
+
+  fSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+  struct sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (fSocket<0 || fSocketPath.size()>=sizeof(address.sun_path)) {
+    G4ExceptionDescription msg;
+    msg << "Cannot create socket " << fSocketPath;
+    G4Exception("JobServer::JobServer()", "MyCode0010", FatalException, msg);
+  }
+  fSocketPath.copy(address.sun_path, fSocketPath.size());
+
+  unlink(fSocketPath.c_str());
+  if (bind(fSocket, (struct sockaddr *)&address, sizeof(address))<0 || listen(fSocket, 16)<0) {
+    G4ExceptionDescription msg;
+    msg << "Cannot listen on socket " << fSocketPath;
+    G4Exception("JobServer::JobServer()", "MyCode0010", FatalException, msg);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+JobServer::~JobServer() {
+  close(fSocket);
+  unlink(fSocketPath.c_str());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void JobServer::Serve() {
+  // build the physics tables now rather than at the first job
+  G4RunManager::GetRunManager()->BeamOn(0);
+  G4cout << "Serving simulation jobs on " << fSocketPath << G4endl;
+
+  G4bool serving = true;
+  while (serving) {
+    G4int connection = accept(fSocket, 0, 0);
+    if (connection<0) continue;
+
+    // a client that never finishes its line must not hold up the others
+    std::string request;
+    G4String requestError = ReadRequest(connection, request);
+    // nor one that never reads its reply
+    struct timeval sendTimeout = {kTimeoutSeconds, 0};
+    setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+
+    std::ostringstream reply;
+    if (requestError!="") {
+      reply << "error " << requestError << "\n";
+    } else if (request=="quit") {
+      reply << "ok quit\n";
+      serving = false;
+    } else if (RunJob(request, reply)) {
+      const RunAction *runAction = (const RunAction *)G4RunManager::GetRunManager()->GetUserRunAction();
+      runAction->WriteHistograms(reply);
+    }
+    reply << "end\n";
+
+    std::string replyString = reply.str();
+    size_t nWritten = 0;
+    while (nWritten<replyString.size()) {
+      // a client gone away must not kill the server with SIGPIPE
+      ssize_t n = send(connection, replyString.data()+nWritten, replyString.size()-nWritten, MSG_NOSIGNAL);
+      if (n<=0) break;
+      nWritten += n;
+    }
+    close(connection);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String JobServer::ReadRequest(G4int connection, std::string &request) {
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point deadline = Clock::now()+std::chrono::seconds(kTimeoutSeconds);
+  char buffer[256];
+  while (request.find('\n')==std::string::npos) {
+    if (request.size()>kMaxRequestSize) return "request longer than "+std::to_string(kMaxRequestSize)+" bytes";
+    G4int remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline-Clock::now()).count();
+    struct pollfd readable = {connection, POLLIN, 0};
+    if (remaining<=0 || poll(&readable, 1, remaining)<=0) return "no complete request within "+std::to_string(kTimeoutSeconds)+" s";
+    ssize_t nRead = read(connection, buffer, sizeof(buffer));
+    if (nRead<=0) break; // closed, the request is what was sent
+    request.append(buffer, nRead);
+  }
+  request = request.substr(0, request.find('\n'));
+  return "";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool JobServer::RunJob(G4String request, std::ostream &reply) {
+  RunConfiguration *configuration = RunConfiguration::Instance();
+  G4String source = configuration->GetSource();
+  G4String spectrumPath = configuration->GetSpectrumPath();
+  G4String spotPath = configuration->GetSpotPath();
+  G4double tubeVoltage = configuration->GetTubeVoltage();
+  G4String outFilePath = "";
+  G4int events = 0;
+  G4long seed = -1;
+  G4bool forcedConversion = configuration->GetForcedConversion();
+  G4bool quasiRandom = configuration->GetQuasiRandom();
+  G4int photonsPerEvent = configuration->GetPhotonsPerEvent();
+
+  std::istringstream requestStream(request);
+  std::string token;
+  while (requestStream >> token) {
+    size_t separator = token.find('=');
+    G4String key = token.substr(0, separator);
+    G4String value = separator==std::string::npos ? "" : token.substr(separator+1);
+    if (key=="source") source = value;
+    else if (key=="spectrum") spectrumPath = value;
+    else if (key=="spot") spotPath = value;
+    else if (key=="kv") tubeVoltage = std::atof(value.c_str());
+    else if (key=="out") outFilePath = value;
+    else if (key=="events") events = std::atoi(value.c_str());
+    else if (key=="seed") seed = std::atol(value.c_str());
+    else if (key=="forced") forcedConversion = value=="1";
+    else if (key=="qmc") quasiRandom = value=="1";
+    else if (key=="photons") photonsPerEvent = std::atoi(value.c_str());
+    else {
+      reply << "error unknown key " << key << "\n";
+      return false;
+    }
+  }
+  if (events<=0 || photonsPerEvent<=0) {
+    reply << "error events and photons must be positive\n";
+    return false;
+  }
+  // the run would stop the server with a fatal exception
+  G4String sourceError = PrimaryGeneratorAction::CheckSource(source, spectrumPath, spotPath, tubeVoltage);
+  if (sourceError!="") {
+    reply << "error " << sourceError << "\n";
+    return false;
+  }
+
+  configuration->SetSource(source);
+  configuration->SetSpectrumPath(spectrumPath);
+  configuration->SetSpotPath(spotPath);
+  configuration->SetTubeVoltage(tubeVoltage);
+  configuration->SetOutFilePath(outFilePath);
+  configuration->SetForcedConversion(forcedConversion);
+  configuration->SetQuasiRandom(quasiRandom);
+  configuration->SetPhotonsPerEvent(photonsPerEvent);
+  if (seed>=0) {
+    G4Random::setTheSeed(seed);
+    configuration->SetQuasiRandomSeed(seed);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  G4RunManager::GetRunManager()->BeamOn(events);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now()-start;
+
+  reply << "ok events " << events << " seconds " << elapsed.count() << "\n";
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
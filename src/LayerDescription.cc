@@ -0,0 +1,125 @@
+/// \file LayerDescription.cc
+/// \brief Implementation of the layer stack helpers
+
+#include "LayerDescription.hh"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+namespace {
+  LayerDescription MakeLayer(G4String material, G4double thickness) {
+    LayerDescription layer;
+    layer.material = material;
+    layer.thickness = thickness;
+    // deexcitation only where the fluorescence matters
+    if (material=="copper" || material=="kapton") {
+      layer.fluo = true;
+      layer.auger = true;
+    }
+    return layer;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+LayerStack GetLayerPreset(G4String geometry) {
+  LayerStack layers;
+  if (geometry=="custom") {
+    layers.push_back(MakeLayer("vacuum", 1.5));
+    layers.push_back(MakeLayer("copper", 35e-3));
+    layers.push_back(MakeLayer("vacuum", 1.0));
+    layers.push_back(MakeLayer("fr4", 3));
+    layers.push_back(MakeLayer("copper", 35e-2));
+  } else if (geometry=="custom10x10") {
+    layers.push_back(MakeLayer("vacuum", 500));
+    layers.push_back(MakeLayer("copper", 35e-3));
+    layers.push_back(MakeLayer("fr4", 3.0));
+    layers.push_back(MakeLayer("copper", 35e-3));
+    layers.push_back(MakeLayer("vacuum", 1.5));
+    layers.push_back(MakeLayer("kapton", 125e-3));
+    layers.push_back(MakeLayer("vacuum", 3.0));
+    layers.push_back(MakeLayer("kapton", 5e-3));
+    layers.push_back(MakeLayer("copper", 5e-3));
+  } else if (geometry=="10x10") {
+    layers.push_back(MakeLayer("vacuum", 1.5));
+    layers.push_back(MakeLayer("kapton", 125e-3));
+    layers.push_back(MakeLayer("vacuum", 3.0));
+    layers.push_back(MakeLayer("kapton", 5e-3));
+    layers.push_back(MakeLayer("copper", 5e-3));
+  } else if (geometry=="ME0") {
+    layers.push_back(MakeLayer("vacuum", 1.5));
+    layers.push_back(MakeLayer("copper", 35e-3));
+    layers.push_back(MakeLayer("fr4", 3.0));
+    layers.push_back(MakeLayer("copper", 35e-3));
+  }
+  return layers;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+LayerStack ReadLayerFile(G4String path) {
+  LayerStack layers;
+  std::ifstream layerFile(path);
+  if (!layerFile) {
+    G4ExceptionDescription msg;
+    msg << "Cannot open layer file " << path;
+    G4Exception("ReadLayerFile()", "MyCode0030", FatalException, msg);
+  }
+
+  std::string line;
+  G4int lineNumber = 0;
+  while (getline(layerFile, line)) {
+    lineNumber++;
+    line = line.substr(0, line.find('#'));
+    std::istringstream lineStream(line);
+    LayerDescription layer;
+    if (!(lineStream >> layer.material)) continue; // blank or comment
+    // the whole thickness token must be a number, "0,035" is not 0
+    std::string thickness;
+    char *end = 0;
+    if (lineStream >> thickness) layer.thickness = std::strtod(thickness.c_str(), &end);
+    if (!end || *end!='\0' || layer.thickness<0.) {
+      G4ExceptionDescription msg;
+      msg << "No valid thickness in mm for " << layer.material << " in " << path << " line " << lineNumber;
+      G4Exception("ReadLayerFile()", "MyCode0030", FatalException, msg);
+    }
+
+    std::string token;
+    while (lineStream >> token) {
+      size_t separator = token.find('=');
+      G4String key = token.substr(0, separator);
+      G4String value = separator==std::string::npos ? "" : token.substr(separator+1);
+      if (key=="cut") layer.cut = std::atof(value.c_str());
+      else if (key=="fluo") layer.fluo = value=="1" || value=="true";
+      else if (key=="auger") layer.auger = value=="1" || value=="true";
+      else if (key=="pixe") layer.pixe = value=="1" || value=="true";
+      else if (key=="msc") layer.msc = value;
+      else if (key=="importance") layer.importance = std::atof(value.c_str());
+      else {
+        G4ExceptionDescription msg;
+        msg << "Unknown layer setting " << key << " in " << path << " line " << lineNumber;
+        G4Exception("ReadLayerFile()", "MyCode0030", FatalException, msg);
+      }
+    }
+    layers.push_back(layer);
+  }
+  return layers;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String GetLayerRegionName(const LayerDescription &layer, G4int materialIndex) {
+  return G4String("Region")+layer.material+std::to_string(materialIndex);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool HasImportances(const LayerStack &layers) {
+  for (auto layer:layers) if (layer.importance!=1.) return true;
+  return false;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
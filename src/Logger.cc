@@ -0,0 +1,129 @@
+/// \file Logger.cc
+/// \brief Implementation of the Logger class
+
+#include "Logger.hh"
+
+#include "G4Threading.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+Logger* Logger::Instance() {
+  static Logger instance;
+  return &instance;
+}
+
+Logger::Logger() {
+  fFlusher = std::thread(&Logger::Loop, this);
+}
+
+Logger::~Logger() {
+  {
+    std::lock_guard<std::mutex> lock(fStopMutex);
+    fStopping = true;
+  }
+  fStopCondition.notify_all();
+  fFlusher.join();
+  Flush();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool Logger::SetLevel(G4String levelName) {
+  if (levelName=="debug") SetLevel(kDebug);
+  else if (levelName=="info") SetLevel(kInfo);
+  else if (levelName=="warning") SetLevel(kWarning);
+  else if (levelName=="error") SetLevel(kError);
+  else return false;
+  return true;
+}
+
+G4long Logger::Admit(Site &site) {
+  G4long occurrence = site.count.fetch_add(1, std::memory_order_relaxed)+1;
+  if (occurrence<=kBurst) return occurrence;
+  for (G4long power=10*kBurst; power<=occurrence; power *= 10)
+    if (occurrence==power) return occurrence;
+  return 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+Logger::Buffer *Logger::GetThreadBuffer() {
+  // registered once per thread, the buffers live as long as the logger
+  thread_local Buffer *buffer = 0;
+  if (!buffer) {
+    std::lock_guard<std::mutex> lock(fBuffersMutex);
+    fBuffers.emplace_back(new Buffer());
+    buffer = fBuffers.back().get();
+    buffer->thread = G4Threading::G4GetThreadId();
+  }
+  return buffer;
+}
+
+void Logger::Write(Severity severity, const std::string &text, G4long occurrence) {
+  Buffer *buffer = GetThreadBuffer();
+  uint64_t head = buffer->head.load(std::memory_order_relaxed);
+  if (head-buffer->tail.load(std::memory_order_acquire)>=kCapacity) {
+    buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  Record &record = buffer->records[head%kCapacity];
+  record.time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  record.severity = severity;
+  record.occurrence = occurrence;
+  size_t length = std::min(text.size(), kTextSize-1);
+  std::memcpy(record.text, text.data(), length);
+  record.text[length] = '\0';
+  buffer->head.store(head+1, std::memory_order_release);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Logger::Flush() {
+  std::lock_guard<std::mutex> drainLock(fDrainMutex);
+  std::vector<std::pair<Record, G4int>> records; // with the thread
+  std::vector<std::pair<G4int, uint64_t>> drops;
+  {
+    std::lock_guard<std::mutex> lock(fBuffersMutex);
+    for (auto &buffer:fBuffers) {
+      uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+      uint64_t head = buffer->head.load(std::memory_order_acquire);
+      for (; tail<head; tail++) records.push_back(std::make_pair(buffer->records[tail%kCapacity], buffer->thread));
+      buffer->tail.store(tail, std::memory_order_release);
+      uint64_t dropped = buffer->dropped.exchange(0, std::memory_order_relaxed);
+      if (dropped>0) drops.push_back(std::make_pair(buffer->thread, dropped));
+    }
+  }
+  std::stable_sort(records.begin(), records.end(),
+      [](const std::pair<Record, G4int> &a, const std::pair<Record, G4int> &b) { return a.first.time<b.first.time; });
+
+  static const char *prefixes[] = {"Debug: ", "", "Warning: ", "Error: "};
+  for (auto &recordPair:records) {
+    const Record &record = recordPair.first;
+    std::ostream &out = record.severity>=kWarning ? std::cerr : std::cout;
+    out << prefixes[record.severity] << record.text;
+    if (recordPair.second>=0) out << " [thread " << recordPair.second << "]";
+    if (record.occurrence>kBurst) out << " (" << record.occurrence << " times, now rate limited)";
+    out << "\n";
+  }
+  for (auto drop:drops) std::cerr << "Warning: " << drop.second << " messages of thread " << drop.first << " dropped, log buffer full\n";
+  if (records.size()>0 || drops.size()>0) {
+    std::cout.flush();
+    std::cerr.flush();
+  }
+}
+
+void Logger::Loop() {
+  std::unique_lock<std::mutex> lock(fStopMutex);
+  while (!fStopCondition.wait_for(lock, std::chrono::milliseconds(50), [this]{ return fStopping; })) {
+    lock.unlock();
+    Flush();
+    lock.lock();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,136 @@
+/// \file LowEnergyEmPhysics.cc
+/// \brief Implementation of the LowEnergyEmPhysics class
+
+#include "LowEnergyEmPhysics.hh"
+
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicsListHelper.hh"
+#include "G4EmParameters.hh"
+#include "G4LossTableManager.hh"
+#include "G4UAtomicDeexcitation.hh"
+
+#include "G4Gamma.hh"
+#include "G4Electron.hh"
+#include "G4Positron.hh"
+
+#include "G4PhotoElectricEffect.hh"
+#include "G4ComptonScattering.hh"
+#include "G4RayleighScattering.hh"
+#include "G4GammaConversion.hh"
+#include "G4eMultipleScattering.hh"
+#include "G4eIonisation.hh"
+#include "G4eBremsstrahlung.hh"
+#include "G4eplusAnnihilation.hh"
+
+#include "G4LivermorePhotoElectricModel.hh"
+#include "G4LivermoreComptonModel.hh"
+#include "G4LivermoreRayleighModel.hh"
+#include "G4LivermoreIonisationModel.hh"
+#include "G4SeltzerBergerModel.hh"
+#include "G4PenelopePhotoElectricModel.hh"
+#include "G4PenelopeComptonModel.hh"
+#include "G4PenelopeRayleighModel.hh"
+#include "G4PenelopeIonisationModel.hh"
+#include "G4PenelopeBremsstrahlungModel.hh"
+#include "G4PenelopeAnnihilationModel.hh"
+#include "G4GoudsmitSaundersonMscModel.hh"
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+LowEnergyEmPhysics::LowEnergyEmPhysics(G4String modelSet):G4VPhysicsConstructor("LowEnergyEmPhysics") {
+  fModelSet = modelSet;
+  if (fModelSet!="livermore" && fModelSet!="penelope") {
+    G4ExceptionDescription msg;
+    msg << "Unknown low-energy model set " << fModelSet << ", use livermore or penelope";
+    G4Exception("LowEnergyEmPhysics::LowEnergyEmPhysics()", "MyCode0020", FatalException, msg);
+  }
+
+  // tables only need to cover the X-ray energies and the resulting electrons
+  G4EmParameters *parameters = G4EmParameters::Instance();
+  parameters->SetDefaults();
+  parameters->SetMinEnergy(100*eV);
+  parameters->SetLowestElectronEnergy(100*eV);
+  parameters->SetMaxEnergy(1*MeV);
+  parameters->SetNumberOfBinsPerDecade(20);
+  parameters->SetFluo(true);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+LowEnergyEmPhysics::~LowEnergyEmPhysics() {}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void LowEnergyEmPhysics::ConstructParticle() {
+  G4Gamma::Definition();
+  G4Electron::Definition();
+  G4Positron::Definition();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void LowEnergyEmPhysics::ConstructProcess() {
+  G4PhysicsListHelper *helper = G4PhysicsListHelper::GetPhysicsListHelper();
+  G4bool penelope = fModelSet=="penelope";
+
+  // gamma
+  G4ParticleDefinition *gamma = G4Gamma::Definition();
+
+  G4PhotoElectricEffect *photoElectric = new G4PhotoElectricEffect();
+  if (penelope) photoElectric->SetEmModel(new G4PenelopePhotoElectricModel());
+  else photoElectric->SetEmModel(new G4LivermorePhotoElectricModel());
+  helper->RegisterProcess(photoElectric, gamma);
+
+  G4ComptonScattering *compton = new G4ComptonScattering();
+  if (penelope) compton->SetEmModel(new G4PenelopeComptonModel());
+  else compton->SetEmModel(new G4LivermoreComptonModel());
+  helper->RegisterProcess(compton, gamma);
+
+  G4RayleighScattering *rayleigh = new G4RayleighScattering();
+  if (penelope) rayleigh->SetEmModel(new G4PenelopeRayleighModel());
+  else rayleigh->SetEmModel(new G4LivermoreRayleighModel());
+  helper->RegisterProcess(rayleigh, gamma);
+
+  helper->RegisterProcess(new G4GammaConversion(), gamma);
+
+  // e-
+  G4ParticleDefinition *electron = G4Electron::Definition();
+
+  G4eMultipleScattering *electronMsc = new G4eMultipleScattering();
+  electronMsc->SetEmModel(new G4GoudsmitSaundersonMscModel());
+  helper->RegisterProcess(electronMsc, electron);
+
+  G4eIonisation *electronIonisation = new G4eIonisation();
+  if (penelope) electronIonisation->SetEmModel(new G4PenelopeIonisationModel());
+  else electronIonisation->SetEmModel(new G4LivermoreIonisationModel());
+  helper->RegisterProcess(electronIonisation, electron);
+
+  G4eBremsstrahlung *electronBremsstrahlung = new G4eBremsstrahlung();
+  if (penelope) electronBremsstrahlung->SetEmModel(new G4PenelopeBremsstrahlungModel());
+  else electronBremsstrahlung->SetEmModel(new G4SeltzerBergerModel());
+  helper->RegisterProcess(electronBremsstrahlung, electron);
+
+  // e+, Penelope models in both sets
+  G4ParticleDefinition *positron = G4Positron::Definition();
+
+  G4eMultipleScattering *positronMsc = new G4eMultipleScattering();
+  positronMsc->SetEmModel(new G4GoudsmitSaundersonMscModel());
+  helper->RegisterProcess(positronMsc, positron);
+
+  G4eIonisation *positronIonisation = new G4eIonisation();
+  positronIonisation->SetEmModel(new G4PenelopeIonisationModel());
+  helper->RegisterProcess(positronIonisation, positron);
+
+  G4eBremsstrahlung *positronBremsstrahlung = new G4eBremsstrahlung();
+  positronBremsstrahlung->SetEmModel(new G4PenelopeBremsstrahlungModel());
+  helper->RegisterProcess(positronBremsstrahlung, positron);
+
+  G4eplusAnnihilation *annihilation = new G4eplusAnnihilation();
+  annihilation->SetEmModel(new G4PenelopeAnnihilationModel());
+  helper->RegisterProcess(annihilation, positron);
+
+  // fluorescence and Auger emission
+  G4LossTableManager::Instance()->SetAtomDeexcitation(new G4UAtomicDeexcitation());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
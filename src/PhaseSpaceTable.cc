@@ -0,0 +1,83 @@
+/// \file PhaseSpaceTable.cc
+/// \brief Implementation of the PhaseSpaceTable class
+
+#include "PhaseSpaceTable.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool PhaseSpaceTable::Read(const std::string &path) {
+  std::ifstream tableFile(path);
+  if (!tableFile) return false;
+  std::vector<double> xs, ys, ws;
+  std::string line;
+  while (std::getline(tableFile, line)) {
+    line = line.substr(0, line.find('#'));
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream lineStream(line);
+    double x, y, w;
+    if (!(lineStream >> x >> y >> w)) continue;
+    xs.push_back(x);
+    ys.push_back(y);
+    ws.push_back(w);
+  }
+  if (xs.empty()) return false;
+
+  std::vector<double> yCentres;
+  fXCentres = xs;
+  yCentres = ys;
+  for (std::vector<double> *centres:{&fXCentres, &yCentres}) {
+    std::sort(centres->begin(), centres->end());
+    centres->erase(std::unique(centres->begin(), centres->end()), centres->end());
+  }
+  fXEdges = GetEdges(fXCentres);
+  fYEdges = GetEdges(yCentres);
+
+  size_t nY = yCentres.size();
+  std::vector<double> weights(fXCentres.size()*nY, 0.);
+  for (size_t i=0; i<xs.size(); i++) {
+    size_t ix = std::lower_bound(fXCentres.begin(), fXCentres.end(), xs[i])-fXCentres.begin();
+    size_t iy = std::lower_bound(yCentres.begin(), yCentres.end(), ys[i])-yCentres.begin();
+    weights[ix*nY+iy] += ws[i];
+  }
+  fCells = AliasTable(weights);
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<double> PhaseSpaceTable::GetEdges(const std::vector<double> &centres) {
+  // a single point is a cell of no width
+  std::vector<double> edges(centres.size()+1);
+  for (size_t i=1; i<centres.size(); i++) edges[i] = 0.5*(centres[i-1]+centres[i]);
+  if (centres.size()==1) edges[0] = edges[1] = centres[0];
+  else {
+    edges.front() = centres.front()-(edges[1]-centres.front());
+    edges.back() = centres.back()+(centres.back()-edges[centres.size()-1]);
+  }
+  return edges;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhaseSpaceTable::Sample(double cellRandom, double xRandom, double yRandom, double &x, double &y) const {
+  int nY = fYEdges.size()-1;
+  int cell = fCells.Sample(cellRandom);
+  int ix = cell/nY, iy = cell%nY;
+  x = fXEdges[ix]+xRandom*(fXEdges[ix+1]-fXEdges[ix]);
+  y = fYEdges[iy]+yRandom*(fYEdges[iy+1]-fYEdges[iy]);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhaseSpaceTable::GetMarginalX(std::vector<double> &centres, std::vector<double> &probabilities) const {
+  int nY = fYEdges.size()-1;
+  centres = fXCentres;
+  probabilities.assign(fXCentres.size(), 0.);
+  for (int cell=0; cell<fCells.GetSize(); cell++) probabilities[cell/nY] += fCells.GetProbability(cell);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -1,47 +1,69 @@
 #include "PhysicsList.hh"
-#include "QBBC.hh"
+#include "LowEnergyEmPhysics.hh"
+#include "ImportanceBiasingPhysics.hh"
+#include "G4EmStandardPhysics_option4.hh"
+#include "StartupProfile.hh"
+#include "Fnv1a.hh"
+#include "Logger.hh"
 #include "globals.hh"
 #include "G4PhysicalConstants.hh"
 #include "G4SystemOfUnits.hh"
-#include "G4ParticleDefinition.hh"
-#include "G4ProcessManager.hh"
-
-#include "G4DecayPhysics.hh"
-#include "G4EmStandardPhysics.hh"
-#include "G4EmStandardPhysics_option4.hh"
-#include "G4EmExtraPhysics.hh"
-#include "G4StoppingPhysics.hh"
-#include "G4OpticalPhysics.hh"
-#include "G4Cerenkov.hh"
-
-#include "G4HadronInelasticQBBC.hh"
-#include "G4HadronElasticPhysics.hh"
-#include "G4HadronElasticPhysicsXS.hh"
-#include "G4HadronElasticPhysicsHP.hh"
-#include "G4ChargeExchangePhysics.hh"
-#include "G4IonPhysicsXS.hh"
-#include "G4IonElasticPhysics.hh"
-#include "G4NeutronTrackingCut.hh"
-
-#include "G4BetheBlochIonGasModel.hh"
-#include "G4BraggIonGasModel.hh"
+#include "G4Material.hh"
+#include "G4Threading.hh"
+#include "G4EmParameters.hh"
 #include "G4EmConfigurator.hh"
 #include "G4LossTableManager.hh"
-#include "G4IonFluctuations.hh"
-#include "G4UniversalFluctuation.hh"
+#include "G4UrbanMscModel.hh"
+#include "G4GoudsmitSaundersonMscModel.hh"
 
-#include "G4EmLivermorePhysics.hh"
-#include "G4EmProcessOptions.hh"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-#include "G4ParticleTable.hh"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace {
+  // a table directory, which holds files only
+  void RemoveDirectory(G4String path) {
+    DIR *directory = opendir(path.c_str());
+    if (!directory) return;
+    while (struct dirent *entry = readdir(directory)) {
+      G4String name = entry->d_name;
+      if (name!="." && name!="..") unlink((path+"/"+name).c_str());
+    }
+    closedir(directory);
+    rmdir(path.c_str());
+  }
+}
 
-PhysicsList::PhysicsList():G4VModularPhysicsList() {
-  emPhysicsList = new G4EmLivermorePhysics();
+PhysicsList::PhysicsList(LayerStack layers, G4String emOption, G4double defaultCut, G4String tableDirectory, G4bool importanceBiasing):G4VModularPhysicsList() {
+  fLayers = layers;
+  fEmOption = emOption;
+  fTableDirectory = tableDirectory;
+
+  if (fEmOption=="option4") emPhysicsList = new G4EmStandardPhysics_option4();
+  else emPhysicsList = new LowEnergyEmPhysics(fEmOption);
   RegisterPhysics(emPhysicsList);
-  RegisterPhysics(new G4EmStandardPhysics());
+  if (importanceBiasing) RegisterPhysics(new ImportanceBiasingPhysics("gamma"));
+
+  // atomic deexcitation only in the layers asking for it,
+  // not in the air of the world and envelope
+  G4EmParameters *emParameters = G4EmParameters::Instance();
+  emParameters->SetDeexActiveRegion("DefaultRegionForTheWorld", false, false, false);
+  G4int materialIndex = 0;
+  for (auto layer:fLayers) {
+    if (layer.material==G4String("vacuum")) continue;
+    materialIndex++;
+    if (layer.auger) emParameters->SetAuger(true);
+    if (layer.pixe) emParameters->SetPixe(true);
+    emParameters->SetDeexActiveRegion(GetLayerRegionName(layer, materialIndex), layer.fluo, layer.auger, layer.pixe);
+  }
   
-  G4double cutForGamma = 0.1*mm;
-  SetCutValue(cutForGamma, "gamma");
+  // --cut sets all particles, gammas included; without it gammas keep 0.1 mm
+  if (defaultCut>0) SetDefaultCutValue(defaultCut);
+  else SetCutValue(0.1*mm, "gamma");
 
   SetVerboseLevel(1);
 }
@@ -51,11 +73,87 @@ PhysicsList::~PhysicsList() {
 }
 
 void PhysicsList::ConstructProcess() {
-  AddTransportation();
-  emPhysicsList->ConstructProcess();
-  G4cout << "constructing physics process" << G4endl;
+  StartupProfile::Scope profileScope("physics processes");
+  G4VModularPhysicsList::ConstructProcess();
 
-  G4EmProcessOptions *emOptions = new G4EmProcessOptions();
-  emOptions->SetFluo(true);
+  // msc model per layer region
+  G4EmConfigurator *emConfigurator = G4LossTableManager::Instance()->EmConfigurator();
+  G4int materialIndex = 0;
+  for (auto layer:fLayers) {
+    if (layer.material==G4String("vacuum")) continue;
+    materialIndex++;
+    if (layer.msc=="") continue;
+    G4String regionName = GetLayerRegionName(layer, materialIndex);
+    for (G4String particleName:{"e-", "e+"}) {
+      G4VMscModel *mscModel = 0;
+      if (layer.msc=="urban") mscModel = new G4UrbanMscModel();
+      else if (layer.msc=="gs") mscModel = new G4GoudsmitSaundersonMscModel();
+      else {
+        G4ExceptionDescription msg;
+        msg << "Unknown msc model " << layer.msc << " for " << regionName << ", use urban or gs";
+        G4Exception("PhysicsList::ConstructProcess()", "MyCode0021", FatalException, msg);
+      }
+      emConfigurator->SetExtraEmModel(particleName, "msc", mscModel, regionName);
+    }
+  }
+}
+
+void PhysicsList::SetCuts() {
+  G4VModularPhysicsList::SetCuts();
+  // tables are built or retrieved at the first run initialisation,
+  // ended in RunAction::BeginOfRunAction()
+  StartupProfile::Instance()->Begin("physics tables");
+  if (fTableDirectory=="") return;
+
+  // tables are kept in one directory per material and cut set
+  fTableKey = TableKey();
+  G4String keyDirectory = fTableDirectory+"/"+fTableKey;
+  struct stat keyStat;
+  if (stat((keyDirectory+"/key.txt").c_str(), &keyStat)==0) {
+    LOG_INFO("Retrieving physics tables from " << keyDirectory);
+    SetPhysicsTableRetrieved(keyDirectory);
+  }
+}
+
+void PhysicsList::StoreTables() {
+  if (fTableDirectory=="" || fTablesStored || IsPhysicsTableRetrieved()) return;
+  if (!G4Threading::IsMasterThread()) return;
+  fTablesStored = true;
+
+  G4String keyDirectory = fTableDirectory+"/"+fTableKey;
+  struct stat keyStat;
+  mkdir(fTableDirectory.c_str(), 0755);
+  if (stat(keyDirectory.c_str(), &keyStat)==0) return; // stored by another job meanwhile
+
+  // written aside and renamed, a job retrieving the tables never sees
+  // them half written; the key file marks the directory as complete
+  G4String newDirectory = fTableDirectory+"/.new-"+fTableKey+"-"+std::to_string(getpid());
+  RemoveDirectory(newDirectory);
+  if (mkdir(newDirectory.c_str(), 0755)!=0) return;
+  G4bool stored = StorePhysicsTable(newDirectory);
+  if (stored) {
+    std::ofstream keyFile(newDirectory+"/key.txt");
+    keyFile << fTableKey << G4endl;
+    stored = bool(keyFile);
+  }
+  // the first complete directory wins, a later one is dropped
+  if (!stored || std::rename(newDirectory.c_str(), keyDirectory.c_str())!=0) {
+    RemoveDirectory(newDirectory);
+    return;
+  }
+  LOG_INFO("Stored physics tables in " << keyDirectory);
+}
+
+G4String PhysicsList::TableKey() const {
+  std::ostringstream description;
+  description << fEmOption << "\n";
+  for (G4Material *material:*G4Material::GetMaterialTable())
+    description << material->GetName() << " " << material->GetDensity()/(g/cm3) << "\n";
+  for (G4String particleName:{"gamma", "e-", "e+", "proton"})
+    description << particleName << " " << GetCutValue(particleName)/mm << "\n";
+  for (auto layer:fLayers)
+    description << layer.material << " " << layer.cut << " " << layer.fluo << " " << layer.auger << " "
+                << layer.pixe << " " << layer.msc << "\n";
+
+  return Fnv1aHex(description.str());
 }
-  
@@ -29,23 +29,36 @@
 
 #include "PrimaryGeneratorAction.hh"
 #include "EventAction.hh"
+#include "RunConfiguration.hh"
+#include "StartupProfile.hh"
+#include "SobolSequence.hh"
+#include "PhaseSpaceTable.hh"
+#include "SourceDescription.hh"
+#include "SlowEventList.hh"
+#include "Fnv1a.hh"
+#include "Logger.hh"
 
 #include "G4LogicalVolumeStore.hh"
 #include "G4LogicalVolume.hh"
 #include "G4Box.hh"
 #include "G4RunManager.hh"
+#include "G4Run.hh"
 #include "G4ParticleGun.hh"
 #include "G4ParticleTable.hh"
 #include "G4ParticleDefinition.hh"
 #include "G4SystemOfUnits.hh"
 #include "Randomize.hh"
 #include "G4Gamma.hh"
+#include "G4Event.hh"
+
+#include <algorithm>
+#include <sstream>
 
 #include "RunAction.hh"
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-PrimaryGeneratorAction::PrimaryGeneratorAction(EventAction *eventAction, G4String source, bool headless)
+PrimaryGeneratorAction::PrimaryGeneratorAction(EventAction *eventAction, bool headless)
   : G4VUserPrimaryGeneratorAction(),
     fParticleGun(0), 
     fEnvelopeBox(0),
@@ -58,13 +71,12 @@ PrimaryGeneratorAction::PrimaryGeneratorAction(EventAction *eventAction, G4Strin
   G4ParticleDefinition* particle = G4Gamma::Definition();
   fParticleGun->SetParticleDefinition(particle);
   
-  fSource = source;
   fHeadless = headless;
   /*this->energies = runAction->GetPrimaryEnergies();
   this->spectrum = runAction->GetPrimarySpectrum();
   this->sumSpectrum = runAction->GetPrimarySpectrumSum();*/
   
-  ReadSpectrumData();
+  Configure();
   
   /*this->energies = runAction->primaryEnergies;
   this->spectrum = runAction->primarySpectrum;
@@ -76,48 +88,189 @@ PrimaryGeneratorAction::PrimaryGeneratorAction(EventAction *eventAction, G4Strin
 PrimaryGeneratorAction::~PrimaryGeneratorAction()
 {
   delete fParticleGun;
+  delete fSobolSequence;
+  delete fPhaseSpaceTable;
+  delete fSpotTable;
 }
 
-void PrimaryGeneratorAction::ReadSpectrumData() {
-  primaryEnergies = new G4DataVector;
-  primarySpectrum = new G4DataVector;
-  primarySpectrumSum = 0.;
-  
-  G4String primarySpectrumPath = "xray-spectrum.csv";
-  ifstream primarySpectrumFile(primarySpectrumPath);
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-  G4double energy;
-  G4double spectrumline;
-  
-  G4String line = "";
-  while (getline(primarySpectrumFile, line)) {
-    sscanf(line.c_str(), "%lf, %lf", &energy, &spectrumline);
-    primaryEnergies->push_back(energy);
-    primarySpectrum->push_back(spectrumline);
-    primarySpectrumSum += spectrumline;
-    //G4cout << line << " " << energy << " " << spectrumline << G4endl;
-    //G4cout << primaryEnergies->size() << primaryEnergies[0] << G4endl;
-  }
-  primarySpectrumFile.close();
-
-  /*G4String primaryAngularDistPath = "source_angular_dist.csv";
-  ifstream primaryAngularDistFile(primaryAngularDistPath);
-
-  G4double angle;
-  G4double angularline;
-  
-  while (getline(primaryAngularDistFile, line)) {
-    sscanf(line.c_str(), "%lf, %lf", &angle, &angularline);
-    primaryAngles->push_back(angle);
-    primaryAngularDist->push_back(angularline);
-    primaryAngularDistSum += angularline;
+void PrimaryGeneratorAction::Configure() {
+  RunConfiguration *configuration = RunConfiguration::Instance();
+  fPhotonsPerEvent = configuration->GetPhotonsPerEvent();
+  fRecordSlowEvents = configuration->GetSlowEvents()>0;
+  fReplayEvent = configuration->GetReplayEvent();
+
+  // event IDs restart with every run, the scrambling changes with it;
+  // a replayed event takes the scrambling of the run it was recorded in
+  delete fSobolSequence;
+  fSobolSequence = 0;
+  if (configuration->GetQuasiRandom()) {
+    const G4Run *run = G4RunManager::GetRunManager()->GetCurrentRun();
+    G4int runID = run ? run->GetRunID() : 0;
+    if (fReplayEvent) runID = fReplayEvent->runID;
+    fSobolSequence = new SobolSequence((uint32_t)configuration->GetQuasiRandomSeed()*2654435761u+runID);
+  }
+
+  // tables are read again only when their path changes
+  if (fSpotPath!=configuration->GetSpotPath()) {
+    fSpotPath = configuration->GetSpotPath();
+    delete fSpotTable;
+    fSpotTable = 0;
+    if (fSpotPath!="") fSpotTable = ReadPhaseSpaceTable(fSpotPath);
+  }
+  if (fSamplePhoton && fSource==configuration->GetSource() && fSpectrumPath==configuration->GetSpectrumPath()
+      && fMonoEnergy==configuration->GetMonoEnergy() && fMonoMinCosTheta==configuration->GetMonoMinCosTheta()
+      && fTubeVoltage==configuration->GetTubeVoltage()) return;
+  fSource = configuration->GetSource();
+  fSpectrumPath = configuration->GetSpectrumPath();
+  fMonoEnergy = configuration->GetMonoEnergy();
+  fMonoMinCosTheta = configuration->GetMonoMinCosTheta();
+  fTubeVoltage = configuration->GetTubeVoltage();
+
+  StartupProfile::Scope profileScope("spectrum loading");
+  SourceDescription description(fSource, fSpectrumPath);
+  delete fPhaseSpaceTable;
+  fPhaseSpaceTable = 0;
+  if (description.GetPhaseSpacePath()!="") {
+    fPhaseSpaceTable = ReadPhaseSpaceTable(description.GetPhaseSpacePath());
+    fSamplePhoton = &PrimaryGeneratorAction::SamplePhaseSpacePhoton;
+    LOG_INFO("Source " << fSource << ": phase space " << description.GetPhaseSpacePath());
+    return;
+  }
+
+  fMinCosTheta = description.GetMinCosTheta();
+  if (fMinCosTheta<1.) fSampleDirection = &PrimaryGeneratorAction::SampleConeDirection;
+  else fSampleDirection = &PrimaryGeneratorAction::SamplePencilDirection;
+  if (description.GetLibraryPath()!="") {
+    // a new voltage only interpolates in the mapping already open
+    G4String libraryPath = description.GetLibraryPath();
+    fQuantiles = ReadLibraryQuantiles(fLibrary, libraryPath==fLibraryPath ? G4String("") : libraryPath,
+        description.GetLibraryFilter(), fTubeVoltage);
+    fLibraryPath = libraryPath;
+    fSamplePhoton = &PrimaryGeneratorAction::SampleQuantilePhoton;
+    LOG_INFO("Source " << fSource << ": " << fTubeVoltage << " kV from " << fLibraryPath);
+    return;
+  }
+  fEnergies = description.GetEnergies();
+  fEnergyTable = AliasTable(description.GetProbabilities());
+  fSamplePhoton = &PrimaryGeneratorAction::SampleLinePhoton;
+  LOG_INFO("Source " << fSource << ": " << fEnergies.size() << " energies");
+}
+
+PhaseSpaceTable *PrimaryGeneratorAction::ReadPhaseSpaceTable(G4String path) {
+  PhaseSpaceTable *table = new PhaseSpaceTable();
+  if (!table->Read(path)) {
+    G4ExceptionDescription msg;
+    msg << "Cannot read phase-space table " << path;
+    G4Exception("PrimaryGeneratorAction::ReadPhaseSpaceTable()", "MyCode0003", FatalException, msg);
+  }
+  return table;
+}
+
+// the library is (re)opened when a path is given
+std::vector<G4double> PrimaryGeneratorAction::ReadLibraryQuantiles(SpectrumLibrary &library, G4String path, G4String filter, G4double voltage) {
+  if (path!="" && !library.Open(path)) {
+    G4ExceptionDescription msg;
+    msg << "Cannot read spectrum library " << path;
+    G4Exception("PrimaryGeneratorAction::ReadLibraryQuantiles()", "MyCode0005", FatalException, msg);
+  }
+  std::vector<G4double> quantiles = library.GetQuantiles(voltage, filter);
+  if (quantiles.size()<2) {
+    G4ExceptionDescription msg;
+    msg << "No " << filter << " spectra around " << voltage << " kV in the spectrum library";
+    G4Exception("PrimaryGeneratorAction::ReadLibraryQuantiles()", "MyCode0005", FatalException, msg);
+  }
+  return quantiles;
+}
+
+void PrimaryGeneratorAction::GetSourceSpectrum(G4String source, G4String spectrumPath, std::vector<G4double> &energies, std::vector<G4double> &probabilities) {
+  SourceDescription description(source, spectrumPath);
+  PhaseSpaceTable table;
+  if (description.GetPhaseSpacePath()!="") {
+    energies.clear();
+    probabilities.clear();
+    if (table.Read(description.GetPhaseSpacePath())) table.GetMarginalX(energies, probabilities);
+    return;
+  }
+  if (description.GetLibraryPath()!="") {
+    // equally probable steps of the quantile function, at their midpoints
+    SpectrumLibrary library;
+    std::vector<G4double> quantiles = ReadLibraryQuantiles(library, description.GetLibraryPath(),
+        description.GetLibraryFilter(), RunConfiguration::Instance()->GetTubeVoltage());
+    energies.clear();
+    for (size_t step=0; step+1<quantiles.size(); step++) energies.push_back(0.5*(quantiles[step]+quantiles[step+1]));
+    probabilities.assign(energies.size(), 1./energies.size());
+    return;
+  }
+  energies = description.GetEnergies();
+  probabilities = description.GetProbabilities();
+}
+
+G4double PrimaryGeneratorAction::GetMinCosTheta(G4String source, G4String spectrumPath) {
+  SourceDescription description(source, spectrumPath);
+  PhaseSpaceTable table;
+  if (description.GetPhaseSpacePath()!="" && table.Read(description.GetPhaseSpacePath()))
+    return std::cos(std::max(std::abs(table.GetYMin()), std::abs(table.GetYMax()))*deg);
+  return description.GetMinCosTheta();
+}
+
+G4String PrimaryGeneratorAction::CheckSource(G4String source, G4String spectrumPath, G4String spotPath, G4double tubeVoltage) {
+  SourceDescription description(source, spectrumPath, false);
+  if (description.GetError()!="") return description.GetError();
+  PhaseSpaceTable table;
+  if (description.GetPhaseSpacePath()!="" && !table.Read(description.GetPhaseSpacePath()))
+    return "Cannot read phase-space table "+description.GetPhaseSpacePath();
+  if (spotPath!="" && !table.Read(spotPath)) return "Cannot read phase-space table "+spotPath;
+  if (description.GetLibraryPath()!="") {
+    SpectrumLibrary library;
+    if (!library.Open(description.GetLibraryPath())) return "Cannot read spectrum library "+description.GetLibraryPath();
+    if (library.GetQuantiles(tubeVoltage, description.GetLibraryFilter()).size()<2)
+      return "No "+description.GetLibraryFilter()+" spectra around "+std::to_string(tubeVoltage)+" kV in the spectrum library";
   }
-  primaryAngularDistFile.close();*/
+  return "";
+}
+
+G4double PrimaryGeneratorAction::GetUniform(G4int dimension) const {
+  if (fSobolSequence) return fSobolSequence->Get(fPointIndex, dimension);
+  return G4UniformRand();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimaryGeneratorAction::SampleLinePhoton(G4double &energy, G4ThreeVector &direction) const {
+  (this->*fSampleDirection)(direction);
+  energy = fEnergies[fEnergyTable.Sample(GetUniform(0))];
+}
+
+void PrimaryGeneratorAction::SamplePhaseSpacePhoton(G4double &energy, G4ThreeVector &direction) const {
+  G4double theta;
+  fPhaseSpaceTable->Sample(GetUniform(0), GetUniform(1), GetUniform(2), energy, theta);
+  theta *= deg;
+  G4double phi = GetUniform(3)*2*CLHEP::pi;
+  direction.set(std::sin(theta)*std::cos(phi), std::sin(theta)*std::sin(phi), std::cos(theta));
+}
+
+void PrimaryGeneratorAction::SampleQuantilePhoton(G4double &energy, G4ThreeVector &direction) const {
+  (this->*fSampleDirection)(direction);
+  // linear between the tabulated quantiles
+  G4double position = GetUniform(0)*(fQuantiles.size()-1);
+  size_t step = std::min((size_t)position, fQuantiles.size()-2);
+  G4double fraction = position-step;
+  energy = fQuantiles[step]+fraction*(fQuantiles[step+1]-fQuantiles[step]);
+}
 
-  G4cout << "Finished ReadSpectrumData()" << G4endl;
-  G4cout << primaryEnergies << G4endl;
+void PrimaryGeneratorAction::SamplePencilDirection(G4ThreeVector &direction) const {
+  direction.set(0., 0., 1.);
 }
 
+void PrimaryGeneratorAction::SampleConeDirection(G4ThreeVector &direction) const {
+  // uniform in solid angle
+  G4double cosTheta = 1.-GetUniform(1)*(1.-fMinCosTheta);
+  G4double sinTheta = std::sqrt(1.-cosTheta*cosTheta);
+  G4double phi = GetUniform(2)*2*CLHEP::pi;
+  direction.set(sinTheta*std::cos(phi), sinTheta*std::sin(phi), cosTheta);
+}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -130,11 +283,31 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
   // on DetectorConstruction class we get Envelope volume
   // from G4LogicalVolumeStore.
   
-  G4double envSizeXY = 0;
   G4double envSizeZ = 0;
 
   if (!runAction) runAction = (RunAction *)G4RunManager::GetRunManager()->GetUserRunAction();
 
+  // HEED is seeded from a hash of the saved engine state, drawing nothing
+  // from the engine, so recording does not change the seeded results
+  G4int eventID = anEvent->GetEventID();
+  G4String savedState;
+  if (fReplayEvent) {
+    std::istringstream engineState(fReplayEvent->engineState);
+    G4Random::getTheEngine()->get(engineState);
+    eventID = fReplayEvent->eventID; // for the quasi-random points
+    savedState = fReplayEvent->engineState;
+  }
+  if (fRecordSlowEvents) {
+    std::ostringstream engineState;
+    G4Random::getTheEngine()->put(engineState);
+    savedState = engineState.str();
+    fEventAction->StartSlowEventClock(savedState);
+  }
+  if (fRecordSlowEvents || fReplayEvent) {
+    unsigned long long hash = Fnv1a(savedState);
+    runAction->heedSimulation->SeedRandom((unsigned int)(hash^(hash>>32)));
+  }
+
   if (!fEnvelopeBox)
     {
       G4LogicalVolume* envLV = G4LogicalVolumeStore::GetInstance()->GetVolume("Envelope");
@@ -142,7 +315,6 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
     }
 
   if ( fEnvelopeBox ) {
-    envSizeXY = fEnvelopeBox->GetXHalfLength()*2.;
     envSizeZ = fEnvelopeBox->GetZHalfLength()*2.;
   }  
   else  {
@@ -154,15 +326,13 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
 		"MyCode0002",JustWarning,msg);
   }
 
-  G4double size = 0.8;
-  G4double x0 = size * envSizeXY * (G4UniformRand()-0.5);
-  G4double y0 = size * envSizeXY * (G4UniformRand()-0.5);
+  // x and y come from the focal spot, see GeneratePrimaryPhoton
   //G4double z0 = -0.5 * envSizeZ; // beam at beginning of environment
   //G4double z0 = 0.; // beam at center of environment
   G4double z0 = -0.15*envSizeZ;
 
   // gaussian positioning, center in (0,0), sigma 1 mm
-  G4double beamSigma = 1.*mm;
+  //G4double beamSigma = 1.*mm;
   //G4double r0 = G4RandGauss::shoot(0, beamSigma);
   
   //x0 = r0*cos(theta0);
@@ -170,48 +340,31 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
   //std::tuple<G4double, G4double> posBeginning = std::make_tuple(x0, y0);
   //fEventAction->AddBeginningPosition(posBeginning);
 
-  x0 = 0;
-  y0 = 0;
   //x0 = G4RandGauss::shoot(0, beamSigma);
   //y0 = G4RandGauss::shoot(0, beamSigma);
-  fParticleGun->SetParticlePosition(G4ThreeVector(x0,y0,z0));
   //fParticleGun->SetParticleMomentumDirection(G4ThreeVector(0.,0.,1.));
-  
-  G4double directionX, directionY, directionZ;
-  // G4double u = G4UniformRand()/4;
-  if (fSource==G4String("xray")) {
-    G4double u = G4UniformRand()*0.117; // 40° angle
-    G4double theta = std::acos(1-2*u);
-    G4double phi = G4UniformRand()*2*CLHEP::pi;
-    directionX = std::sin(theta)*std::cos(phi);
-    directionY = std::sin(theta)*std::sin(phi);
-    directionZ = std::cos(theta);
-  } else {
-    directionX = 0.;
-    directionY = 0.;
-    directionZ = 1.;
-  }
-  fParticleGun->SetParticleMomentumDirection(G4ThreeVector(directionX, directionY, directionZ));
-
-  G4double particleEnergy = 0.;
-  if (fSource==G4String("xray")) {
-    G4double partSumSpectrum = 0.;
-    G4int j = 0;
-    G4double random = primarySpectrumSum*G4UniformRand();
-    while (partSumSpectrum<random) {
-      partSumSpectrum += (*primarySpectrum)[j];
-      j++;
-    }
-    particleEnergy = (*primaryEnergies)[j];
-  } else if (fSource==G4String("fe55")) {
-    G4double energyRand = G4UniformRand();
-    if (energyRand<=this->ironLineIntensities[0]) particleEnergy = ironLineEnergies[0];
-    else particleEnergy = ironLineEnergies[1];
-  } else if (fSource==G4String("cd109")) {
-    G4double energyRand = G4UniformRand();
-    if (energyRand<=this->cadmiumLineIntensities[0]) particleEnergy = cadmiumLineEnergies[0];
-    else particleEnergy = cadmiumLineEnergies[1];
+
+  // one vertex per photon, the primaries get track IDs 1 to fPhotonsPerEvent
+  for (G4int photon=0; photon<fPhotonsPerEvent; photon++) {
+    fPointIndex = (G4long)eventID*fPhotonsPerEvent+photon;
+    GeneratePrimaryPhoton(anEvent, z0);
   }
+}
+
+void PrimaryGeneratorAction::GeneratePrimaryPhoton(G4Event* anEvent, G4double z0) {
+  // point source on the axis, or a point of the focal spot
+  G4double x0 = 0., y0 = 0.;
+  if (fSpotTable) {
+    fSpotTable->Sample(GetUniform(4), GetUniform(5), GetUniform(6), x0, y0);
+    x0 *= mm;
+    y0 *= mm;
+  }
+  fParticleGun->SetParticlePosition(G4ThreeVector(x0,y0,z0));
+
+  G4double particleEnergy;
+  G4ThreeVector direction;
+  (this->*fSamplePhoton)(particleEnergy, direction);
+  fParticleGun->SetParticleMomentumDirection(direction);
 
   fParticleGun->SetParticleEnergy(particleEnergy*keV);
   fParticleGun->GeneratePrimaryVertex(anEvent);
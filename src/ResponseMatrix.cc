@@ -0,0 +1,100 @@
+/// \file ResponseMatrix.cc
+/// \brief Implementation of the ResponseMatrix class
+
+#include "ResponseMatrix.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ResponseMatrix::ResponseMatrix(int nIn, double inMin, double inMax, int nOut, double outMin, double outMax):
+  fNIn(nIn), fNOut(nOut), fInMin(inMin), fInMax(inMax), fOutMin(outMin), fOutMax(outMax),
+  fElements((size_t)nIn*nOut, 0.) {}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool ResponseMatrix::Read(const std::string &path) {
+  std::ifstream matrixFile(path);
+  std::string keyword;
+  if (!std::getline(matrixFile, fDescription)) return false;
+  if (!(matrixFile >> keyword >> fNIn >> fInMin >> fInMax) || keyword!="input") return false;
+  if (!(matrixFile >> keyword >> fNOut >> fOutMin >> fOutMax) || keyword!="output") return false;
+  fElements.assign((size_t)fNIn*fNOut, 0.);
+  for (int out=0; out<fNOut; out++)
+    for (int in=0; in<fNIn; in++)
+      if (!(matrixFile >> (*this)(out, in))) return false;
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool ResponseMatrix::Write(const std::string &path) const {
+  // written aside and renamed, a reader never sees half a matrix
+  std::string temporaryPath = path+".tmp";
+  std::ofstream matrixFile(temporaryPath);
+  matrixFile << fDescription << "\n";
+  matrixFile << "input " << fNIn << " " << fInMin << " " << fInMax << "\n";
+  matrixFile << "output " << fNOut << " " << fOutMin << " " << fOutMax << "\n";
+  matrixFile << std::setprecision(9);
+  for (int out=0; out<fNOut; out++) {
+    for (int in=0; in<fNIn; in++) matrixFile << (in>0 ? " " : "") << (*this)(out, in);
+    matrixFile << "\n";
+  }
+  matrixFile.close();
+  if (!matrixFile) return false;
+  return std::rename(temporaryPath.c_str(), path.c_str())==0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ResponseMatrix::SetColumn(int in, const std::vector<double> &column) {
+  std::copy(column.begin(), column.begin()+std::min((int)column.size(), fNOut), fElements.begin()+(size_t)in*fNOut);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<double> ResponseMatrix::Apply(const std::vector<double> &input) const {
+  std::vector<double> output(fNOut, 0.);
+  double *__restrict__ outputData = output.data();
+  for (int in=0; in<fNIn; in++) {
+    const double scale = input[in];
+    if (scale==0.) continue;
+    const double *__restrict__ column = GetColumn(in);
+    for (int out=0; out<fNOut; out++) outputData[out] += scale*column[out];
+  }
+  return output;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<double> ResponseMatrix::Bin(const std::vector<double> &values, const std::vector<double> &weights) const {
+  std::vector<double> binned(fNIn, 0.);
+  for (size_t i=0; i<values.size(); i++) {
+    int bin = std::floor((values[i]-fInMin)/(fInMax-fInMin)*fNIn);
+    if (bin>=0 && bin<fNIn) binned[bin] += weights[i];
+  }
+  return binned;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ResponseMatrix ResponseMatrix::Then(const ResponseMatrix &next) const {
+  ResponseMatrix product(fNIn, fInMin, fInMax, next.fNOut, next.fOutMin, next.fOutMax);
+  // every product column is next applied to one of our columns
+  for (int in=0; in<fNIn; in++) {
+    double *__restrict__ productColumn = &product.fElements[(size_t)in*next.fNOut];
+    for (int middle=0; middle<next.fNIn && middle<fNOut; middle++) {
+      const double scale = (*this)(middle, in);
+      if (scale==0.) continue;
+      const double *__restrict__ nextColumn = next.GetColumn(middle);
+      for (int out=0; out<next.fNOut; out++) productColumn[out] += scale*nextColumn[out];
+    }
+  }
+  return product;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,216 @@
+/// \file ResultCache.cc
+/// \brief Implementation of the ResultCache class
+
+#include "ResultCache.hh"
+#include "RunConfiguration.hh"
+#include "SourceDescription.hh"
+#include "Fnv1a.hh"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+namespace {
+  // hash of the whole file, "missing" if it cannot be read
+  std::string HashFile(G4String path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return "missing";
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return Fnv1aHex(contents.str());
+  }
+
+  G4bool CopyFile(G4String fromPath, G4String toPath) {
+    std::ifstream fromFile(fromPath, std::ios::binary);
+    if (!fromFile) return false;
+    std::ofstream toFile(toPath, std::ios::binary);
+    toFile << fromFile.rdbuf();
+    return bool(toFile);
+  }
+
+  G4bool Exists(G4String path) {
+    struct stat fileStat;
+    return stat(path.c_str(), &fileStat)==0;
+  }
+
+  // the file and, recursively, the macros it runs with /control/execute,
+  // /control/loop or /control/foreach
+  void DescribeMacro(G4String path, std::ostringstream &description, G4int depth = 0) {
+    description << "macro " << path << " " << HashFile(path) << "\n";
+    std::ifstream macroFile(path);
+    std::string line;
+    while (depth<10 && std::getline(macroFile, line)) {
+      std::istringstream lineStream(line);
+      std::string command, macroPath;
+      lineStream >> command >> macroPath;
+      if ((command=="/control/execute" || command=="/control/loop" || command=="/control/foreach") && macroPath!="")
+        DescribeMacro(macroPath, description, depth+1);
+    }
+  }
+
+  // Geant4 data sets, by path and modification time; the version is part
+  // of the directory name
+  const char *kDataVariables[] = {"G4LEDATA", "G4LEVELGAMMADATA", "G4NEUTRONHPDATA", "G4NEUTRONXSDATA",
+    "G4RADIOACTIVEDATA", "G4ABLADATA", "G4PIIDATA", "G4REALSURFACEDATA", "G4SAIDXSDATA",
+    "G4ENSDFSTATEDATA", "G4PARTICLEXSDATA", "G4INCLDATA", "G4PHOTONEVAPORATIONDATA"};
+
+  void DescribeData(std::ostringstream &description) {
+    for (const char *variable:kDataVariables) {
+      const char *path = getenv(variable);
+      if (!path) continue;
+      struct stat dataStat;
+      description << "data " << variable << " " << path << " ";
+      if (stat(path, &dataStat)==0) description << dataStat.st_mtime << "\n";
+      else description << "missing\n";
+    }
+  }
+
+  // shared libraries mapped into the process, Geant4, ROOT and Garfield
+  // among them, by path, size and modification time
+  void DescribeLibraries(std::ostringstream &description) {
+    std::ifstream mapsFile("/proc/self/maps");
+    std::set<std::string> paths;
+    std::string line;
+    while (std::getline(mapsFile, line)) {
+      size_t pathStart = line.find('/');
+      if (pathStart==std::string::npos || line.find(".so", pathStart)==std::string::npos) continue;
+      paths.insert(line.substr(pathStart));
+    }
+    for (const std::string &path:paths) {
+      struct stat libraryStat;
+      if (stat(path.c_str(), &libraryStat)!=0) continue;
+      description << "library " << path << " " << libraryStat.st_size << " " << libraryStat.st_mtime << "\n";
+    }
+  }
+
+  // an entry directory and its files
+  void RemoveEntry(G4String entryPath) {
+    unlink((entryPath+"/description.txt").c_str());
+    unlink((entryPath+"/out.root").c_str());
+    unlink((entryPath+"/summary.json").c_str());
+    rmdir(entryPath.c_str());
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ResultCache::ResultCache(G4String directory) {
+  fDirectory = directory;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String ResultCache::Describe(const LayerStack &layers, G4String emOption, G4double cut,
+    G4String macroPath, G4long seed) {
+  RunConfiguration *configuration = RunConfiguration::Instance();
+  std::ostringstream description;
+  description << std::setprecision(17);
+
+  struct stat executableStat;
+  if (stat("/proc/self/exe", &executableStat)==0)
+    description << "executable " << executableStat.st_size << " " << executableStat.st_mtime << "\n";
+  DescribeLibraries(description);
+  DescribeData(description);
+  for (auto layer:layers)
+    description << "layer " << layer.material << " " << layer.thickness << " " << layer.cut << " " << layer.fluo << " "
+                << layer.auger << " " << layer.pixe << " " << layer.msc << " " << layer.importance << "\n";
+  description << "physics " << emOption << " " << cut << " " << configuration->GetImportanceBiasing() << " "
+              << configuration->GetParticleConversions() << "\n";
+
+  G4String source = configuration->GetSource();
+  description << "source " << source << " " << configuration->GetMonoEnergy() << " " << configuration->GetTubeVoltage() << " "
+              << configuration->GetPhotonsPerEvent() << " " << configuration->GetForcedConversion() << " "
+              << configuration->GetQuasiRandom() << " " << configuration->GetSensitivity() << "\n";
+  if (source!=G4String("mono")) {
+    SourceDescription sourceDescription(source, configuration->GetSpectrumPath());
+    for (auto path:sourceDescription.GetInputPaths()) description << "file " << path << " " << HashFile(path) << "\n";
+  }
+  if (configuration->GetSpotPath()!="")
+    description << "spot " << configuration->GetSpotPath() << " " << HashFile(configuration->GetSpotPath()) << "\n";
+
+  DescribeMacro(macroPath, description);
+  description << "seed " << seed << "\n";
+  return description.str();
+}
+
+G4String ResultCache::GetKey(G4String description) {
+  return Fnv1aHex(description);
+}
+
+G4String ResultCache::GetEntryPath(G4String description) const {
+  return fDirectory+"/"+GetKey(description);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool ResultCache::Fetch(G4String description, G4String outFilePath, G4String summaryPath) const {
+  G4String entryPath = GetEntryPath(description);
+  // a colliding key is a miss, not someone else's results
+  std::ifstream descriptionFile(entryPath+"/description.txt");
+  std::ostringstream cachedDescription;
+  cachedDescription << descriptionFile.rdbuf();
+  if (!descriptionFile || cachedDescription.str()!=description) return false;
+  if (outFilePath!="" && !Exists(entryPath+"/out.root")) return false;
+  if (summaryPath!="" && !Exists(entryPath+"/summary.json")) return false;
+
+  if (outFilePath!="" && !CopyFile(entryPath+"/out.root", outFilePath)) return false;
+  if (summaryPath!="") {
+    // the summary says it was not simulated this time
+    std::ifstream cachedFile(entryPath+"/summary.json");
+    std::ostringstream cachedSummary;
+    cachedSummary << cachedFile.rdbuf();
+    std::string summary = cachedSummary.str();
+    size_t cachedField = summary.find("\"cached\": false");
+    if (!cachedFile || cachedField==std::string::npos) return false;
+    summary.replace(cachedField, std::string("\"cached\": false").size(), "\"cached\": true");
+    std::ofstream summaryFile(summaryPath);
+    summaryFile << summary;
+    if (!summaryFile) return false;
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ResultCache::Store(G4String description, G4String outFilePath, G4String summaryPath) const {
+  G4String entryPath = GetEntryPath(description);
+  G4String suffix = GetKey(description)+"-"+std::to_string(getpid());
+  mkdir(fDirectory.c_str(), 0755);
+
+  // filled aside and renamed into place, so that an entry is never seen
+  // half written, even by another process
+  G4String newPath = fDirectory+"/.new-"+suffix;
+  RemoveEntry(newPath);
+  if (mkdir(newPath.c_str(), 0755)!=0) return;
+  G4bool complete = (outFilePath=="" || CopyFile(outFilePath, newPath+"/out.root"))
+                 && (summaryPath=="" || CopyFile(summaryPath, newPath+"/summary.json"));
+  if (complete) {
+    std::ofstream descriptionFile(newPath+"/description.txt");
+    descriptionFile << description;
+    complete = bool(descriptionFile);
+  }
+  if (!complete) {
+    RemoveEntry(newPath);
+    return;
+  }
+
+  if (rename(newPath.c_str(), entryPath.c_str())!=0) {
+    // a previous entry is in the way, moved out as a whole first
+    G4String oldPath = fDirectory+"/.old-"+suffix;
+    if (rename(entryPath.c_str(), oldPath.c_str())==0) {
+      rename(newPath.c_str(), entryPath.c_str());
+      RemoveEntry(oldPath);
+    }
+    RemoveEntry(newPath);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
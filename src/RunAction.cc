@@ -30,8 +30,11 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <iomanip>
+#include <cmath>
 
 #include <sys/stat.h>
+#include <sys/resource.h>
 
 #include <TCanvas.h>
 #include <TROOT.h>
@@ -47,7 +50,11 @@
 #include <TTree.h>
 
 #include "RunAction.hh"
+#include "RunConfiguration.hh"
+#include "StartupProfile.hh"
+#include "Logger.hh"
 #include "PrimaryGeneratorAction.hh"
+#include "PhysicsList.hh"
 #include "DetectorConstruction.hh"
 
 #include "G4RunManager.hh"
@@ -58,16 +65,27 @@
 #include "G4UnitsTable.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4ThreeVector.hh"
+#include "G4Threading.hh"
+#include "G4AutoLock.hh"
+
+namespace {
+  G4Mutex mergeMutex = G4MUTEX_INITIALIZER;
+}
+
+RunAction *RunAction::fMasterRunAction = 0;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-RunAction::RunAction(G4bool headless, string outFilePath, std::vector<std::pair<G4String, G4double>> layersMap): G4UserRunAction() {
+RunAction::RunAction(G4bool headless, LayerStack layersMap): G4UserRunAction() {
   this->headless = headless;
-  this->heedSimulation = new HeedSimulation(this);
+  {
+    StartupProfile::Scope profileScope("HEED gas setup");
+    this->heedSimulation = new HeedSimulation(this);
+  }
   fLayersMap = layersMap;
   fHitEnergyMap = new std::map<G4String, G4double>();
 
-  runFile = new TFile(outFilePath.c_str(), "RECREATE", "Simulation output ntuples");
+  if (G4Threading::IsMasterThread()) fMasterRunAction = this;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -80,24 +98,70 @@ void RunAction::BeginOfRunAction(const G4Run* run) {
   // inform the runManager to save random number seed
   G4RunManager::GetRunManager()->SetRandomNumberStore(false);
 
+  // physics tables have been built by now
+  if (IsMaster()) {
+    StartupProfile::Instance()->End("physics tables");
+    PhysicsList *physicsList = (PhysicsList *)G4RunManager::GetRunManager()->GetUserPhysicsList();
+    if (physicsList) physicsList->StoreTables();
+  }
+
   if (volumeBranchNames.size()==0) {
     volumeBranchNames.push_back(G4String("primary"));
     G4int materialIndex = 0;
-    for (auto materialNameThicknessPair:fLayersMap) {
-      G4String materialName = materialNameThicknessPair.first;
+    for (auto layer:fLayersMap) {
+      G4String materialName = layer.material;
       if (materialName==G4String("vacuum")) continue;
       materialIndex++;
       volumeBranchNames.push_back(G4String(materialName+std::to_string(materialIndex)));
     }
     volumeBranchNames.push_back(G4String("conversion"));
+    BookHistograms();
   }
+  for (auto histogramPair:fHistogramMap) histogramPair.second->Reset();
+  for (auto &regionTimePair:fRegionTimeMap) regionTimePair.second = 0.;
+  INSTRUMENT(fInstrumentation.BeginRun());
+  fSlowEvents.SetCapacity(RunConfiguration::Instance()->GetSlowEvents());
+  fSlowEvents.Clear();
+  fForcedConversions = 0;
+  fForcedConversionFailures = 0;
+
+  // the master starts the status thread before any worker begins its run
+  RunConfiguration *configuration = RunConfiguration::Instance();
+  if (IsMaster()) RunStatus::Instance()->Start(configuration->GetStatusPath(), configuration->GetStatusInterval(),
+      run->GetRunID(), run->GetNumberOfEventToBeProcessed());
+  fStatusCounters = RunStatus::Instance()->GetCounters();
+  fRunStart = std::chrono::steady_clock::now();
+
+  // the output file is opened per run, so that a process serving
+  // several jobs can write each of them to a different file
+  G4String outFilePath = RunConfiguration::Instance()->GetOutFilePath();
+  if (outFilePath!="") runFile = new TFile(outFilePath.c_str(), "RECREATE", "Simulation output ntuples");
+
+  // a new run may change the source or spectrum
+  PrimaryGeneratorAction *generatorAction = (PrimaryGeneratorAction *)G4RunManager::GetRunManager()->GetUserPrimaryGeneratorAction();
+  if (generatorAction) generatorAction->Configure();
+
   for (G4String volumeBranchName:volumeBranchNames) {
     (*fHitEnergyMap)[volumeBranchName] = 0.;
     treeMap[volumeBranchName] = new TTree(volumeBranchName, "");
     treeMap[volumeBranchName]->Branch("energy", &((*fHitEnergyMap)[volumeBranchName]), "energy/D");
+    // one unless biased (forced conversion, importance sampling)
+    fHitWeightMap[volumeBranchName] = 1.;
+    treeMap[volumeBranchName]->Branch("weight", &fHitWeightMap[volumeBranchName], "weight/D");
   }
   treeMap["conversion"]->Branch("primaries", &gasPrimaries, "primaries/D");
 
+  // the MT master fills no rows, every worker writes files of its own
+  G4String columnsPath = configuration->GetColumnsPath();
+  if (columnsPath!="" && !(IsMaster() && G4Threading::IsMultithreadedApplication())) {
+    G4int thread = G4Threading::IsMultithreadedApplication() ? G4Threading::G4GetThreadId() : -1;
+    for (G4String volumeBranchName:volumeBranchNames) {
+      vector<G4String> columns = {"energy", "weight"};
+      if (volumeBranchName=="conversion") columns.push_back("primaries");
+      fColumnWriters[volumeBranchName] = new ColumnWriter(columnsPath, volumeBranchName, columns, thread);
+    }
+  }
+
   nOfEvents = run->GetNumberOfEventToBeProcessed();
   G4cout << G4endl;
 }
@@ -113,28 +177,257 @@ void RunAction::EndOfRunAction(const G4Run* run) {
   mkdir(eps_out_dir.c_str(), 0700);*/
 
   G4int nofEvents = run->GetNumberOfEvent();
-  if (nofEvents == 0) return;
+  if (IsMaster()) RunStatus::Instance()->Stop(); // the workers are done
+  // the MT master processes no events of its own
+  INSTRUMENT(if (!IsMaster() || !G4Threading::IsMultithreadedApplication()) fInstrumentation.EndRun(nofEvents));
+  if (nofEvents>0 && !IsMaster()) MergeIntoMaster();
+  if (nofEvents>0 && IsMaster()) {
+    Logger::Instance()->Flush(); // messages of the run before its tables
+    PrintRegionTimes();
+    WriteSlowEvents();
+    G4String summaryPath = RunConfiguration::Instance()->GetSummaryPath();
+    if (summaryPath!="") WriteSummary(summaryPath, run);
+    StartupProfile::Instance()->Print();
+  }
 
-  if (this->headless) {
-    G4cout << G4endl;
-    for (auto treePair:treeMap) treePair.second->Print();
-    runFile->Write();
-    runFile->Close();
+  if (runFile) {
+    if (this->headless && nofEvents>0) {
+      G4cout << G4endl;
+      for (auto treePair:treeMap) treePair.second->Print();
+      runFile->Write();
+    }
+    runFile->Close(); // also deletes the trees
+    delete runFile;
+    runFile = 0;
+  } else {
+    for (auto treePair:treeMap) delete treePair.second;
+  }
+  treeMap.clear();
+  for (auto writerPair:fColumnWriters) delete writerPair.second; // closes the files
+  fColumnWriters.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunAction::BookHistograms() {
+  for (G4String volumeBranchName:volumeBranchNames) {
+    TH1D *histogram = new TH1D(volumeBranchName, ";Energy (keV);", kEnergyBins, kEnergyMin, kEnergyMax);
+    histogram->SetDirectory(0);
+    histogram->Sumw2();
+    fHistogramMap[volumeBranchName] = histogram;
+  }
+  TH1D *primariesHistogram = new TH1D("primaries", ";Primary electrons;", 2000, 0., 2000.);
+  primariesHistogram->SetDirectory(0);
+  primariesHistogram->Sumw2();
+  fHistogramMap["primaries"] = primariesHistogram;
+
+  if (!RunConfiguration::Instance()->GetSensitivity()) return;
+  for (G4String volumeBranchName:volumeBranchNames) {
+    if (volumeBranchName=="primary" || volumeBranchName=="conversion") continue;
+    G4String name = "primaries_d"+volumeBranchName;
+    TH1D *derivativeHistogram = new TH1D(name, ";Primary electrons;Derivative per unit relative density", 2000, 0., 2000.);
+    derivativeHistogram->SetDirectory(0);
+    derivativeHistogram->Sumw2();
+    fHistogramMap[name] = derivativeHistogram;
+  }
+}
+
+void RunAction::MergeIntoMaster() {
+  G4AutoLock lock(&mergeMutex);
+  for (auto histogramPair:fHistogramMap)
+    fMasterRunAction->fHistogramMap[histogramPair.first]->Add(histogramPair.second);
+  for (auto regionTimePair:fRegionTimeMap)
+    fMasterRunAction->fRegionTimeMap[regionTimePair.first] += regionTimePair.second;
+  INSTRUMENT(fMasterRunAction->fInstrumentation.Merge(fInstrumentation));
+  fMasterRunAction->fSlowEvents.Merge(fSlowEvents);
+  fMasterRunAction->fForcedConversions += fForcedConversions;
+  fMasterRunAction->fForcedConversionFailures += fForcedConversionFailures;
+}
+
+void RunAction::PrintRegionTimes() const {
+  G4double totalTime = 0.;
+  for (auto regionTimePair:fRegionTimeMap) totalTime += regionTimePair.second;
+  if (totalTime<=0.) return;
+
+  G4cout << G4endl << "Stepping time per region, summed over threads:" << G4endl;
+  for (auto regionTimePair:fRegionTimeMap) {
+    G4cout << "  " << std::setw(28) << std::left << regionTimePair.first << std::right;
+    G4cout << std::setw(12) << std::setprecision(4) << regionTimePair.second << " s ";
+    G4cout << std::setw(6) << std::setprecision(3) << 100.*regionTimePair.second/totalTime << " %" << G4endl;
+  }
+}
+
+G4String RunAction::GetSlowEventPath(const SlowEvent &event) {
+  return "slow-event-r"+std::to_string(event.runID)+"-e"+std::to_string(event.eventID)+".txt";
+}
+
+void RunAction::WriteSlowEvents() const {
+  std::vector<SlowEvent> events = fSlowEvents.GetSorted();
+  if (events.size()==0) return;
+  G4cout << G4endl << "Slowest events, replay with --replay-event <file>:" << G4endl;
+  for (const SlowEvent &event:events) {
+    G4String path = GetSlowEventPath(event);
+    SlowEventList::Write(event, path);
+    G4cout << "  " << std::setw(10) << event.eventID << std::setw(12) << std::setprecision(4) << event.seconds << " s ";
+    G4cout << std::setw(10) << event.steps << " steps  " << path << G4endl;
+  }
+}
+
+void RunAction::WriteSummary(G4String summaryPath, const G4Run *run) {
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now()-fRunStart;
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  std::ofstream summaryFile(summaryPath);
+  summaryFile << std::setprecision(10);
+  summaryFile << "{\n";
+  summaryFile << "  \"cached\": false,\n"; // true in copies from the result cache
+  summaryFile << "  \"events\": " << run->GetNumberOfEvent() << ",\n";
+  summaryFile << "  \"seconds\": " << elapsed.count() << ",\n";
+  summaryFile << "  \"events_per_second\": " << run->GetNumberOfEvent()/elapsed.count() << ",\n";
+  G4int photonsPerEvent = RunConfiguration::Instance()->GetPhotonsPerEvent();
+  summaryFile << "  \"photons_per_event\": " << photonsPerEvent << ",\n";
+  summaryFile << "  \"photons\": " << (G4long)run->GetNumberOfEvent()*photonsPerEvent << ",\n";
+  summaryFile << "  \"photons_per_second\": " << run->GetNumberOfEvent()*photonsPerEvent/elapsed.count() << ",\n";
+  summaryFile << "  \"peak_rss_kb\": " << usage.ru_maxrss << ",\n";
+  summaryFile << "  \"forced_conversion\": " << (RunConfiguration::Instance()->GetForcedConversion() ? "true" : "false") << ",\n";
+  summaryFile << "  \"particle_conversions\": " << (RunConfiguration::Instance()->GetParticleConversions() ? "true" : "false") << ",\n";
+  summaryFile << "  \"forced_conversions\": " << fForcedConversions << ",\n";
+  summaryFile << "  \"forced_conversion_failures\": " << fForcedConversionFailures << ",\n";
+
+  summaryFile << "  \"region_seconds\": {";
+  G4String separator = "";
+  for (auto regionTimePair:fRegionTimeMap) {
+    summaryFile << separator << "\n    \"" << regionTimePair.first << "\": " << regionTimePair.second;
+    separator = ",";
+  }
+  summaryFile << "\n  },\n";
+
+  summaryFile << "  \"slow_events\": [";
+  separator = "";
+  for (const SlowEvent &event:fSlowEvents.GetSorted()) {
+    summaryFile << separator << "\n    {\"run\": " << event.runID << ", \"event\": " << event.eventID;
+    summaryFile << ", \"seconds\": " << event.seconds << ", \"steps\": " << event.steps << ", \"tracks\": {";
+    G4String trackSeparator = "";
+    for (auto trackPair:event.tracks) {
+      summaryFile << trackSeparator << "\"" << trackPair.first << "\": " << trackPair.second;
+      trackSeparator = ", ";
+    }
+    summaryFile << "}, \"file\": \"" << GetSlowEventPath(event) << "\"}";
+    separator = ",";
+  }
+  summaryFile << "\n  ],\n";
+
+#ifdef GEMXRAY_INSTRUMENT
+  summaryFile << "  \"instrumentation\": ";
+  fInstrumentation.WriteJson(summaryFile, "  ");
+  summaryFile << ",\n";
+#endif
+
+  summaryFile << "  \"histograms\": {";
+  separator = "";
+  for (auto histogramPair:fHistogramMap) {
+    TH1D *histogram = histogramPair.second;
+    summaryFile << separator << "\n    \"" << histogramPair.first << "\": {";
+    summaryFile << "\"min\": " << histogram->GetXaxis()->GetXmin() << ", ";
+    summaryFile << "\"max\": " << histogram->GetXaxis()->GetXmax() << ", \"contents\": [";
+    for (G4int bin=1; bin<=histogram->GetNbinsX(); bin++)
+      summaryFile << (bin>1 ? ", " : "") << histogram->GetBinContent(bin);
+    // sum of squared weights, the variance of the weighted contents
+    summaryFile << "], \"sumw2\": [";
+    for (G4int bin=1; bin<=histogram->GetNbinsX(); bin++)
+      summaryFile << (bin>1 ? ", " : "") << std::pow(histogram->GetBinError(bin), 2);
+    summaryFile << "]}";
+    separator = ",";
+  }
+  summaryFile << "\n  },\n";
+
+  // uncollided part of the same spectra, the rest of the Monte Carlo
+  // is scattered or fluorescence
+  summaryFile << "  \"analytic\": {";
+  separator = "";
+  for (auto spectrumPair:GetAnalyticSpectra(run->GetNumberOfEvent()*photonsPerEvent)) {
+    G4double analyticSum = 0.;
+    summaryFile << separator << "\n    \"" << spectrumPair.first << "\": {\"contents\": [";
+    for (size_t bin=0; bin<spectrumPair.second.size(); bin++) {
+      summaryFile << (bin>0 ? ", " : "") << spectrumPair.second[bin];
+      analyticSum += spectrumPair.second[bin];
+    }
+    G4double monteCarloSum = fHistogramMap.at(spectrumPair.first)->Integral();
+    summaryFile << "], \"uncollided_fraction\": " << (monteCarloSum>0 ? analyticSum/monteCarloSum : 0.) << "}";
+    separator = ",";
+  }
+  summaryFile << "\n  }\n}\n";
+}
+
+map<G4String, vector<G4double>> RunAction::GetAnalyticSpectra(G4double nEvents) {
+  if (!fAnalyticAttenuation) fAnalyticAttenuation = new AnalyticAttenuation(fLayersMap);
+
+  RunConfiguration *configuration = RunConfiguration::Instance();
+  vector<G4double> energies, probabilities;
+  PrimaryGeneratorAction::GetSourceSpectrum(configuration->GetSource(), configuration->GetSpectrumPath(), energies, probabilities);
+  return fAnalyticAttenuation->Compute(energies, probabilities,
+    PrimaryGeneratorAction::GetMinCosTheta(configuration->GetSource(), configuration->GetSpectrumPath()), nEvents,
+    kEnergyBins, kEnergyMin, kEnergyMax);
+}
+
+void RunAction::WriteAnalyticSpectra(G4String path) {
+  auto start = std::chrono::steady_clock::now();
+  map<G4String, vector<G4double>> spectra = GetAnalyticSpectra(1.);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now()-start;
+
+  // same layout as the histograms of the run summary, per source photon
+  std::ofstream spectraFile(path);
+  spectraFile << std::setprecision(10);
+  spectraFile << "{\n  \"seconds\": " << elapsed.count() << ",\n  \"histograms\": {";
+  G4String separator = "";
+  for (auto spectrumPair:spectra) {
+    spectraFile << separator << "\n    \"" << spectrumPair.first << "\": {";
+    spectraFile << "\"min\": " << kEnergyMin << ", ";
+    spectraFile << "\"max\": " << kEnergyMax << ", \"contents\": [";
+    for (size_t bin=0; bin<spectrumPair.second.size(); bin++)
+      spectraFile << (bin>0 ? ", " : "") << spectrumPair.second[bin];
+    spectraFile << "]}";
+    separator = ",";
+  }
+  spectraFile << "\n  }\n}\n";
+  G4cout << "Analytic uncollided spectra written to " << path << " in " << elapsed.count()*1e3 << " ms" << G4endl;
+}
+
+void RunAction::WriteHistograms(std::ostream &out) const {
+  for (auto histogramPair:fHistogramMap) {
+    TH1D *histogram = histogramPair.second;
+    G4int nBins = histogram->GetNbinsX();
+    out << "histogram " << histogramPair.first << " " << nBins << " ";
+    out << histogram->GetXaxis()->GetXmin() << " " << histogram->GetXaxis()->GetXmax() << "\n";
+    for (G4int bin=1; bin<=nBins; bin++) out << histogram->GetBinContent(bin) << (bin<nBins ? " " : "\n");
   }
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-void RunAction::FillNtuples(G4String volume, G4double energy) {
+void RunAction::FillNtuples(G4String volume, G4double energy, G4double weight) {
+  INSTRUMENT(Instrumentation::Scope instrumentationScope(fInstrumentation, Instrumentation::kFillNtuples));
   (*fHitEnergyMap)[volume] = energy;
+  fHitWeightMap[volume] = weight;
   treeMap[volume]->Fill();
+  fHistogramMap[volume]->Fill(energy, weight);
+  if (!fColumnWriters.empty()) fColumnWriters[volume]->Fill({energy, weight});
 }
 
-void RunAction::FillNtuples(G4String volume, G4double energy, G4int primaries) {
+void RunAction::FillNtuples(G4String volume, G4double energy, G4int primaries, G4double weight) {
+  INSTRUMENT(Instrumentation::Scope instrumentationScope(fInstrumentation, Instrumentation::kFillNtuples));
   if (this->headless) {
     (*fHitEnergyMap)[volume] = energy;
     gasPrimaries = primaries;
+    fHitWeightMap[volume] = weight;
     treeMap[volume]->Fill();
+    fHistogramMap[volume]->Fill(energy, weight);
+    fHistogramMap["primaries"]->Fill(primaries, weight);
+    if (!fColumnWriters.empty()) fColumnWriters[volume]->Fill({energy, weight, (G4double)primaries});
+    if (fStatusCounters) fStatusCounters->AddConversion(weight);
+    for (auto scorePair:fSensitivityScores)
+      fHistogramMap["primaries_d"+scorePair.first]->Fill(primaries, weight*scorePair.second);
   }
 }
 
@@ -150,6 +443,7 @@ void RunAction::FillNtuples(G4String volume, G4double energy, G4ThreeVector posi
   hitMomentumZ = momentum.getZ();
   
   treeMap[volume]->Fill();
+  if (!fColumnWriters.empty()) fColumnWriters[volume]->Fill({energy, fHitWeightMap[volume]});
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
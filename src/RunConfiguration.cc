@@ -0,0 +1,17 @@
+/// \file RunConfiguration.cc
+/// \brief Implementation of the RunConfiguration class
+
+#include "RunConfiguration.hh"
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+RunConfiguration* RunConfiguration::Instance() {
+  static RunConfiguration instance;
+  return &instance;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+RunConfiguration::RunConfiguration() {}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
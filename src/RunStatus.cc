@@ -0,0 +1,135 @@
+/// \file RunStatus.cc
+/// \brief Implementation of the RunStatus class
+
+#include "RunStatus.hh"
+
+#include "G4Threading.hh"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+RunStatus* RunStatus::Instance() {
+  static RunStatus instance;
+  return &instance;
+}
+
+RunStatus::RunStatus() {
+  for (G4long &events:fLastEvents) events = 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+RunStatus::Counters *RunStatus::GetCounters() {
+  if (fPath=="") return 0;
+  G4int slot = G4Threading::G4GetThreadId()+1; // the master is -1
+  if (slot<0 || slot>kMaxThreads) return 0;
+  return &fCounters[slot];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunStatus::Start(G4String path, G4double interval, G4int runID, G4long eventsToProcess) {
+  Stop();
+  if (path=="") return;
+  fPath = path;
+  fInterval = interval;
+  fRunID = runID;
+  fEventsToProcess = eventsToProcess;
+  // no worker is running yet
+  for (G4int slot=0; slot<=kMaxThreads; slot++) {
+    fCounters[slot].events = 0;
+    fCounters[slot].conversions = 0.;
+    fCounters[slot].conversions2 = 0.;
+    fLastEvents[slot] = 0;
+  }
+  fStart = fLastWrite = Clock::now();
+  fStopping = false;
+  Write(false);
+  fThread = std::thread(&RunStatus::Loop, this);
+}
+
+void RunStatus::Stop() {
+  if (!fThread.joinable()) return;
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStopping = true;
+  }
+  fStopCondition.notify_all();
+  fThread.join();
+  Write(true);
+  fPath = "";
+}
+
+void RunStatus::Loop() {
+  std::unique_lock<std::mutex> lock(fMutex);
+  while (!fStopCondition.wait_for(lock, std::chrono::duration<double>(fInterval), [this]{ return fStopping; }))
+    Write(false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunStatus::Write(G4bool finished) {
+  Clock::time_point now = Clock::now();
+  G4double elapsed = std::chrono::duration<double>(now-fStart).count();
+  G4double sinceLastWrite = std::chrono::duration<double>(now-fLastWrite).count();
+  fLastWrite = now;
+
+  G4long events = 0;
+  G4double conversions = 0., conversions2 = 0.;
+  for (G4int slot=0; slot<=kMaxThreads; slot++) {
+    events += fCounters[slot].events.load(std::memory_order_relaxed);
+    conversions += fCounters[slot].conversions.load(std::memory_order_relaxed);
+    conversions2 += fCounters[slot].conversions2.load(std::memory_order_relaxed);
+  }
+  G4double rate = elapsed>0. ? events/elapsed : 0.;
+
+  // resident and peak memory
+  long residentPages = 0;
+  FILE *statm = fopen("/proc/self/statm", "r");
+  if (statm) {
+    if (fscanf(statm, "%*ld %ld", &residentPages)!=1) residentPages = 0;
+    fclose(statm);
+  }
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  G4String temporaryPath = fPath+".tmp";
+  std::ofstream statusFile(temporaryPath);
+  statusFile << std::setprecision(8);
+  statusFile << "{\n";
+  statusFile << "  \"state\": \"" << (finished ? "finished" : "running") << "\",\n";
+  statusFile << "  \"run\": " << fRunID << ",\n";
+  statusFile << "  \"elapsed_seconds\": " << elapsed << ",\n";
+  statusFile << "  \"events_done\": " << events << ",\n";
+  statusFile << "  \"events_total\": " << fEventsToProcess << ",\n";
+  statusFile << "  \"events_per_second\": " << rate << ",\n";
+  statusFile << "  \"eta_seconds\": " << (finished ? 0. : rate>0. ? (fEventsToProcess-events)/rate : -1.) << ",\n";
+  statusFile << "  \"rss_kb\": " << residentPages*(sysconf(_SC_PAGESIZE)/1024) << ",\n";
+  statusFile << "  \"peak_rss_kb\": " << usage.ru_maxrss << ",\n";
+  // Poisson-like relative error of the weighted conversion count
+  statusFile << "  \"conversions\": " << conversions << ",\n";
+  statusFile << "  \"relative_precision\": " << (conversions>0. ? std::sqrt(conversions2)/conversions : -1.) << ",\n";
+  statusFile << "  \"threads\": [";
+  G4String separator = "";
+  for (G4int slot=0; slot<=kMaxThreads; slot++) {
+    G4long threadEvents = fCounters[slot].events.load(std::memory_order_relaxed);
+    if (threadEvents==0) continue;
+    // since the previous write, the average for the first one
+    G4double threadRate = sinceLastWrite>0. ? (threadEvents-fLastEvents[slot])/sinceLastWrite : 0.;
+    fLastEvents[slot] = threadEvents;
+    statusFile << separator << "\n    {\"thread\": " << slot-1 << ", \"events\": " << threadEvents << ", \"events_per_second\": " << threadRate << "}";
+    separator = ",";
+  }
+  statusFile << "\n  ]\n}\n";
+  statusFile.close();
+  std::rename(temporaryPath.c_str(), fPath.c_str());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,100 @@
+/// \file SlowEventList.cc
+/// \brief Implementation of the SlowEventList class
+
+#include "SlowEventList.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+  // min-heap on the wall time
+  bool Slower(const SlowEvent &a, const SlowEvent &b) { return a.seconds>b.seconds; }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SlowEventList::Add(const SlowEvent &event) {
+  if (fCapacity==0) return;
+  if (fEvents.size()==fCapacity) {
+    if (event.seconds<=fEvents.front().seconds) return;
+    std::pop_heap(fEvents.begin(), fEvents.end(), Slower);
+    fEvents.pop_back();
+  }
+  fEvents.push_back(event);
+  std::push_heap(fEvents.begin(), fEvents.end(), Slower);
+}
+
+void SlowEventList::Merge(const SlowEventList &other) {
+  for (const SlowEvent &event:other.fEvents) Add(event);
+}
+
+std::vector<SlowEvent> SlowEventList::GetSorted() const {
+  std::vector<SlowEvent> events = fEvents;
+  std::sort(events.begin(), events.end(), Slower);
+  return events;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SlowEventList::Write(const SlowEvent &event, G4String path) {
+  std::ofstream eventFile(path);
+  eventFile << std::setprecision(10);
+  eventFile << "# slow event, run again with --replay-event " << path << "\n";
+  eventFile << "# and the same --stack or --geometry, physics and cut options\n";
+  if (event.threads>1)
+    eventFile << "# recorded with " << event.threads << " threads sharing the HEED engine: only the Geant4 part replays exactly\n";
+  eventFile << "run " << event.runID << "\n";
+  eventFile << "event " << event.eventID << "\n";
+  eventFile << "seconds " << event.seconds << "\n";
+  eventFile << "steps " << event.steps << "\n";
+  for (auto trackPair:event.tracks) eventFile << "tracks " << trackPair.first << " " << trackPair.second << "\n";
+  eventFile << "source " << event.source << "\n";
+  eventFile << "spectrum " << event.spectrumPath << "\n";
+  eventFile << "kv " << event.tubeVoltage << "\n";
+  eventFile << "spot " << event.spotPath << "\n";
+  eventFile << "photons_per_event " << event.photonsPerEvent << "\n";
+  eventFile << "forced_conversion " << event.forcedConversion << "\n";
+  eventFile << "quasi_random " << event.quasiRandom << " " << event.quasiRandomSeed << "\n";
+  eventFile << "importance_biasing " << event.importanceBiasing << "\n";
+  eventFile << "threads " << event.threads << "\n";
+  // the state spans several lines, up to the end of the file
+  eventFile << "engine\n" << event.engineState;
+}
+
+G4bool SlowEventList::Read(G4String path, SlowEvent &event) {
+  std::ifstream eventFile(path);
+  if (!eventFile) return false;
+  std::string line;
+  G4bool hasEngine = false;
+  while (std::getline(eventFile, line)) {
+    if (line=="engine") {
+      std::ostringstream state;
+      state << eventFile.rdbuf();
+      event.engineState = state.str();
+      hasEngine = true;
+      break;
+    }
+    std::istringstream lineStream(line.substr(0, line.find('#')));
+    std::string key, name;
+    if (!(lineStream >> key)) continue;
+    if (key=="run") lineStream >> event.runID;
+    else if (key=="event") lineStream >> event.eventID;
+    else if (key=="seconds") lineStream >> event.seconds;
+    else if (key=="steps") lineStream >> event.steps;
+    else if (key=="tracks" && lineStream >> name) lineStream >> event.tracks[name];
+    else if (key=="source") lineStream >> event.source;
+    else if (key=="spectrum") lineStream >> event.spectrumPath;
+    else if (key=="kv") lineStream >> event.tubeVoltage;
+    else if (key=="spot") lineStream >> event.spotPath;
+    else if (key=="photons_per_event") lineStream >> event.photonsPerEvent;
+    else if (key=="forced_conversion") lineStream >> event.forcedConversion;
+    else if (key=="quasi_random") lineStream >> event.quasiRandom >> event.quasiRandomSeed;
+    else if (key=="importance_biasing") lineStream >> event.importanceBiasing;
+    else if (key=="threads") lineStream >> event.threads;
+  }
+  return hasEngine;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
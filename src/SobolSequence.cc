@@ -0,0 +1,72 @@
+/// \file SobolSequence.cc
+/// \brief Implementation of the SobolSequence class
+
+#include "SobolSequence.hh"
+
+namespace {
+  // primitive polynomials and initial direction numbers of Joe and Kuo
+  // (new-joe-kuo-6.21201) for the dimensions after the first
+  const int polynomialDegrees[7] = {1, 2, 3, 3, 4, 4, 5};
+  const uint32_t polynomialCoefficients[7] = {0, 1, 1, 2, 1, 4, 2};
+  const uint32_t initialNumbers[7][5] = {{1}, {1, 3}, {1, 3, 1}, {1, 1, 1}, {1, 1, 3, 3}, {1, 3, 5, 13}, {1, 1, 5, 5, 17}};
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+SobolSequence::SobolSequence(uint32_t seed) {
+  // the first dimension is the van der Corput sequence
+  for (int bit=0; bit<32; bit++) fDirections[0][bit] = 1u<<(31-bit);
+  for (int dimension=1; dimension<nDimensions; dimension++) {
+    int degree = polynomialDegrees[dimension-1];
+    uint32_t coefficients = polynomialCoefficients[dimension-1];
+    uint32_t *directions = fDirections[dimension];
+    for (int bit=0; bit<degree; bit++) directions[bit] = initialNumbers[dimension-1][bit]<<(31-bit);
+    for (int bit=degree; bit<32; bit++) {
+      directions[bit] = directions[bit-degree]^(directions[bit-degree]>>degree);
+      for (int k=1; k<degree; k++)
+        if ((coefficients>>(degree-1-k))&1) directions[bit] ^= directions[bit-k];
+    }
+  }
+  for (int dimension=0; dimension<nDimensions; dimension++) fSeeds[dimension] = Hash(seed^Hash(dimension+1));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+uint32_t SobolSequence::ReverseBits(uint32_t x) {
+  x = ((x>>1)&0x55555555u)|((x&0x55555555u)<<1);
+  x = ((x>>2)&0x33333333u)|((x&0x33333333u)<<2);
+  x = ((x>>4)&0x0f0f0f0fu)|((x&0x0f0f0f0fu)<<4);
+  x = ((x>>8)&0x00ff00ffu)|((x&0x00ff00ffu)<<8);
+  return (x>>16)|(x<<16);
+}
+
+uint32_t SobolSequence::Hash(uint32_t x) {
+  x ^= x>>16;
+  x *= 0x7feb352du;
+  x ^= x>>15;
+  x *= 0x846ca68bu;
+  x ^= x>>16;
+  return x;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+double SobolSequence::Get(uint32_t index, int dimension) const {
+  uint32_t x = 0;
+  for (int bit=0; index; index>>=1, bit++)
+    if (index&1) x ^= fDirections[dimension][bit];
+
+  // nested uniform scramble: every bit is flipped depending on the bits above it,
+  // which a Laine-Karras permutation does on the reversed word
+  x = ReverseBits(x);
+  x += fSeeds[dimension];
+  x ^= x*0x6c50b47cu;
+  x ^= x*0xb82f1e52u;
+  x ^= x*0xc7afe638u;
+  x ^= x*0x8d22f6e6u;
+  x = ReverseBits(x);
+
+  return (x+0.5)/4294967296.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
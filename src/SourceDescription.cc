@@ -0,0 +1,144 @@
+/// \file SourceDescription.cc
+/// \brief Implementation of the SourceDescription class
+
+#include "SourceDescription.hh"
+#include "RunConfiguration.hh"
+
+#include "G4SystemOfUnits.hh"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+SourceDescription::SourceDescription(G4String source, G4String spectrumPath, G4bool fatal) {
+  fFatal = fatal;
+  if (source==G4String("mono")) {
+    fEnergies = {RunConfiguration::Instance()->GetMonoEnergy()};
+    fProbabilities = {1.};
+    fMinCosTheta = RunConfiguration::Instance()->GetMonoMinCosTheta();
+    return;
+  }
+  Read(source, spectrumPath, 0);
+  if (fPhaseSpacePath=="" && fLibraryPath=="") Normalise(0, 1.);
+  if (fError=="" && fEnergies.empty() && fPhaseSpacePath=="" && fLibraryPath=="")
+    Fail("SourceDescription::SourceDescription()", "Source "+source+" has no energies");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SourceDescription::Fail(const char *where, G4String message) {
+  if (!fFatal) {
+    if (fError=="") fError = message;
+    return;
+  }
+  G4ExceptionDescription msg;
+  msg << message;
+  G4Exception(where, "MyCode0004", FatalException, msg);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SourceDescription::Read(G4String source, G4String spectrumPath, G4int depth) {
+  G4String path = source;
+  std::ifstream sourceFile(path);
+  if (!sourceFile) {
+    path = "sources/"+source+".src";
+    sourceFile.open(path);
+  }
+  if (!sourceFile || depth>8) {
+    Fail("SourceDescription::Read()", "Cannot read source "+source+(depth>8 ? ", sources include each other" : ""));
+    return;
+  }
+  fInputPaths.push_back(path);
+
+  std::string line;
+  while (std::getline(sourceFile, line)) {
+    std::istringstream lineStream(line.substr(0, line.find('#')));
+    std::string keyword;
+    if (!(lineStream >> keyword)) continue;
+    if (keyword=="line") {
+      G4double energy, intensity;
+      if (lineStream >> energy >> intensity) {
+        fEnergies.push_back(energy);
+        fProbabilities.push_back(intensity);
+        continue;
+      }
+    } else if (keyword=="spectrum") {
+      std::string spectrumFile;
+      G4double weight = 1.;
+      if (lineStream >> spectrumFile) {
+        lineStream >> weight;
+        AddSpectrum(spectrumFile=="configured" ? spectrumPath : G4String(spectrumFile), weight);
+        continue;
+      }
+    } else if (keyword=="source") {
+      std::string component;
+      G4double weight;
+      if (lineStream >> component >> weight) {
+        size_t componentFirst = fEnergies.size();
+        Read(component, spectrumPath, depth+1);
+        Normalise(componentFirst, weight);
+        continue;
+      }
+    } else if (keyword=="phasespace") {
+      std::string tablePath;
+      fPhaseSpacePath = lineStream >> tablePath ? G4String(tablePath) : spectrumPath;
+      fInputPaths.push_back(fPhaseSpacePath);
+      continue;
+    } else if (keyword=="library") {
+      std::string libraryPath, filter;
+      if (lineStream >> libraryPath) {
+        fLibraryPath = libraryPath;
+        fInputPaths.push_back(fLibraryPath);
+        if (lineStream >> filter) fLibraryFilter = filter;
+        continue;
+      }
+    } else if (keyword=="direction") {
+      std::string shape;
+      G4double halfAngle;
+      if (lineStream >> shape && shape=="pencil") {
+        if (depth==0) fMinCosTheta = 1.;
+        continue;
+      }
+      if (shape=="cone" && lineStream >> halfAngle) {
+        if (depth==0) fMinCosTheta = std::cos(halfAngle*deg);
+        continue;
+      }
+    }
+    Fail("SourceDescription::Read()", "Invalid statement in "+path+": "+line);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SourceDescription::AddSpectrum(G4String path, G4double scale) {
+  std::ifstream spectrumFile(path);
+  if (!spectrumFile) {
+    Fail("SourceDescription::AddSpectrum()", "Cannot read spectrum "+path);
+    return;
+  }
+  fInputPaths.push_back(path);
+  size_t first = fEnergies.size();
+  std::string line;
+  G4double energy, intensity;
+  while (std::getline(spectrumFile, line)) {
+    if (sscanf(line.c_str(), "%lf, %lf", &energy, &intensity)!=2 || intensity<=0.) continue;
+    fEnergies.push_back(energy);
+    fProbabilities.push_back(intensity);
+  }
+  Normalise(first, scale);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SourceDescription::Normalise(size_t first, G4double scale) {
+  G4double sum = 0.;
+  for (size_t i=first; i<fProbabilities.size(); i++) sum += fProbabilities[i];
+  if (sum<=0.) return;
+  for (size_t i=first; i<fProbabilities.size(); i++) fProbabilities[i] *= scale/sum;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,141 @@
+/// \file SpectrumLibrary.cc
+/// \brief Implementation of the SpectrumLibrary class
+
+#include "SpectrumLibrary.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+  // cumulative probability of a quantile table, piecewise linear between
+  // its steps, below an energy (left limit) and up to it; repeated
+  // energies of a line make the CDF jump there
+  double CdfBelow(const double *table, int nQuantiles, double energy) {
+    if (energy<=table[0]) return 0.;
+    if (energy>table[nQuantiles]) return 1.;
+    int step = std::lower_bound(table, table+nQuantiles+1, energy)-table-1;
+    return (step+(energy-table[step])/(table[step+1]-table[step]))/nQuantiles;
+  }
+
+  double CdfAt(const double *table, int nQuantiles, double energy) {
+    if (energy<table[0]) return 0.;
+    if (energy>=table[nQuantiles]) return 1.;
+    int step = std::upper_bound(table, table+nQuantiles+1, energy)-table-1;
+    return (step+(energy-table[step])/(table[step+1]-table[step]))/nQuantiles;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+SpectrumLibrary::SpectrumLibrary() {}
+
+SpectrumLibrary::~SpectrumLibrary() {
+  Close();
+}
+
+void SpectrumLibrary::Close() {
+  if (fData) munmap((void *)fData, fSize);
+  fData = 0;
+  fSize = 0;
+  fNSettings = fNQuantiles = 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool SpectrumLibrary::Open(const std::string &path) {
+  Close();
+  int descriptor = open(path.c_str(), O_RDONLY);
+  if (descriptor<0) return false;
+  struct stat status;
+  if (fstat(descriptor, &status)<0 || status.st_size<16) {
+    close(descriptor);
+    return false;
+  }
+  void *data = mmap(0, status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+  close(descriptor); // the mapping stays valid
+  if (data==MAP_FAILED) return false;
+  fData = (const char *)data;
+  fSize = status.st_size;
+
+  uint32_t counts[2];
+  std::memcpy(counts, fData+8, sizeof(counts));
+  fNSettings = counts[0];
+  fNQuantiles = counts[1];
+  // every table must lie within the file
+  bool valid = std::memcmp(fData, "GEMSPEC1", 8)==0 && fNQuantiles>0 && 16+sizeof(Entry)*fNSettings<=fSize;
+  for (int setting=0; valid && setting<fNSettings; setting++)
+    valid = GetEntry(setting)->offset%8==0 && GetEntry(setting)->offset+8*(fNQuantiles+1)<=fSize;
+  if (!valid) Close();
+  return valid;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const SpectrumLibrary::Entry *SpectrumLibrary::GetEntry(int setting) const {
+  return (const Entry *)(fData+16)+setting;
+}
+
+double SpectrumLibrary::GetVoltage(int setting) const {
+  return GetEntry(setting)->voltage;
+}
+
+std::string SpectrumLibrary::GetFilter(int setting) const {
+  const char *filter = GetEntry(setting)->filter;
+  return std::string(filter, strnlen(filter, sizeof(Entry::filter)));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<double> SpectrumLibrary::GetQuantiles(double voltage, const std::string &filter) const {
+  // closest tabulated voltages below and above, of this filtration
+  int below = -1, above = -1;
+  for (int setting=0; setting<fNSettings; setting++) {
+    if (GetFilter(setting)!=filter) continue;
+    double settingVoltage = GetVoltage(setting);
+    if (settingVoltage<=voltage && (below<0 || settingVoltage>GetVoltage(below))) below = setting;
+    if (settingVoltage>=voltage && (above<0 || settingVoltage<GetVoltage(above))) above = setting;
+  }
+  if (below<0 || above<0) return std::vector<double>();
+
+  const double *belowTable = (const double *)(fData+GetEntry(below)->offset);
+  const double *aboveTable = (const double *)(fData+GetEntry(above)->offset);
+  double fraction = above==below ? 0. : (voltage-GetVoltage(below))/(GetVoltage(above)-GetVoltage(below));
+  if (fraction<=0.) return std::vector<double>(belowTable, belowTable+fNQuantiles+1);
+  if (fraction>=1.) return std::vector<double>(aboveTable, aboveTable+fNQuantiles+1);
+
+  // interpolated CDF at every energy of either table, as (energy, CDF)
+  // points of a monotonic curve; a jump is a vertical pair at one energy
+  std::vector<double> energies(belowTable, belowTable+fNQuantiles+1);
+  energies.insert(energies.end(), aboveTable, aboveTable+fNQuantiles+1);
+  std::sort(energies.begin(), energies.end());
+  energies.erase(std::unique(energies.begin(), energies.end()), energies.end());
+  std::vector<double> curveEnergies, curveCdfs;
+  for (double energy:energies) {
+    curveEnergies.push_back(energy);
+    curveCdfs.push_back((1.-fraction)*CdfBelow(belowTable, fNQuantiles, energy)+fraction*CdfBelow(aboveTable, fNQuantiles, energy));
+    curveEnergies.push_back(energy);
+    curveCdfs.push_back((1.-fraction)*CdfAt(belowTable, fNQuantiles, energy)+fraction*CdfAt(aboveTable, fNQuantiles, energy));
+  }
+
+  // inverted at the same probability steps
+  std::vector<double> quantiles(fNQuantiles+1);
+  size_t point = 0;
+  for (int step=0; step<=fNQuantiles; step++) {
+    double probability = std::min((double)step/fNQuantiles, curveCdfs.back());
+    while (curveCdfs[point]<probability) point++;
+    if (point==0 || curveCdfs[point]==curveCdfs[point-1]) {
+      quantiles[step] = curveEnergies[point];
+      continue;
+    }
+    double weight = (probability-curveCdfs[point-1])/(curveCdfs[point]-curveCdfs[point-1]);
+    quantiles[step] = curveEnergies[point-1]+weight*(curveEnergies[point]-curveEnergies[point-1]);
+  }
+  return quantiles;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
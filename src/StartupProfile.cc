@@ -0,0 +1,65 @@
+/// \file StartupProfile.cc
+/// \brief Implementation of the StartupProfile class
+
+#include "StartupProfile.hh"
+
+#include "G4ios.hh"
+
+#include <iomanip>
+#include <sstream>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+StartupProfile* StartupProfile::Instance() {
+  static StartupProfile instance;
+  return &instance;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+StartupProfile::StartupProfile() {
+  fProcessStart = Clock::now();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StartupProfile::Begin(G4String section) {
+  if (!fEnabled) return;
+  std::lock_guard<std::mutex> lock(fMutex);
+  if (fBeginTimes.count(section)) return;
+  fBeginTimes[section] = Clock::now();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StartupProfile::End(G4String section) {
+  if (!fEnabled) return;
+  Clock::time_point now = Clock::now();
+  std::lock_guard<std::mutex> lock(fMutex);
+  auto beginTime = fBeginTimes.find(section);
+  if (beginTime==fBeginTimes.end()) return;
+  for (auto sectionTime:fSectionTimes) if (sectionTime.first==section) return;
+  std::chrono::duration<double> elapsed = now-beginTime->second;
+  fSectionTimes.push_back(std::make_pair(section, elapsed.count()));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StartupProfile::Print() {
+  if (!fEnabled) return;
+  std::lock_guard<std::mutex> lock(fMutex);
+  if (fPrinted) return;
+  fPrinted = true;
+
+  std::chrono::duration<double> total = Clock::now()-fProcessStart;
+  fSectionTimes.push_back(std::make_pair(G4String("total to end of run"), total.count()));
+
+  std::ostringstream profile;
+  profile << std::fixed << std::setprecision(3);
+  profile << "Startup profile (wall clock, seconds):\n";
+  for (auto sectionTime:fSectionTimes)
+    profile << "  " << std::setw(24) << std::left << sectionTime.first << std::setw(10) << std::right << sectionTime.second << "\n";
+  G4cout << G4endl << profile.str() << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
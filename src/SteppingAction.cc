@@ -30,12 +30,17 @@
 #include "SteppingAction.hh"
 #include "EventAction.hh"
 #include "DetectorConstruction.hh"
+#include "RunConfiguration.hh"
+#include "AttenuationTable.hh"
+#include "Logger.hh"
 
 #include "G4Step.hh"
 #include "G4Event.hh"
 #include "G4RunManager.hh"
 #include "G4LogicalVolume.hh"
 #include "G4LogicalVolumeStore.hh"
+#include "G4Region.hh"
+#include "G4VProcess.hh"
 
 #include <TMath.h>
 
@@ -59,16 +64,24 @@ SteppingAction::~SteppingAction()
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 void SteppingAction::UserSteppingAction(const G4Step* step) {
+  INSTRUMENT(Instrumentation &instrumentation = eventAction->GetRunAction()->GetInstrumentation());
+  INSTRUMENT(Instrumentation::Scope instrumentationScope(instrumentation, Instrumentation::kStepping));
   G4Track *track = step->GetTrack();
   G4int trackID = track->GetTrackID();
 
-  if (track->GetCurrentStepNumber()==1 and trackID==1) eventAction->AddHit("primary", track->GetVertexKineticEnergy()*1e3);
+  // primary photon of the track, looked up again only when the track changes
+  if (track->GetCurrentStepNumber()==1) fPrimary = eventAction->RegisterTrack(trackID, track->GetParentID());
+  else if (trackID!=fTrackID) fPrimary = eventAction->GetTrackPrimary(trackID);
+  fTrackID = trackID;
+  eventAction->CountStep(track);
+
+  if (track->GetCurrentStepNumber()==1 and track->GetParentID()==0) eventAction->AddHit("primary", track->GetVertexKineticEnergy()*1e3, 1., fPrimary);
 
   //if (!windowKaptonVolume || !driftKaptonVolume || !driftCopperVolume) {
   if (volumesBeforeDrift.size()==0) {
     G4int materialIndex = 0;
-    for (auto materialNameThicknessPair:fLayersMap) {
-      G4String materialName = materialNameThicknessPair.first;
+    for (auto layer:fLayersMap) {
+      G4String materialName = layer.material;
       if (materialName==G4String("vacuum")) continue;
       materialIndex++;
       G4String logicalName = G4String("Logical")+materialName+std::to_string(materialIndex);
@@ -76,6 +89,7 @@ void SteppingAction::UserSteppingAction(const G4Step* step) {
       //cout << volume << " " << (volume==NULL) << endl;
       volumesBeforeDrift.push_back(volume);
       volumeBranchNames.push_back(G4String(materialName+std::to_string(materialIndex)));
+      if (RunConfiguration::Instance()->GetSensitivity()) fAttenuationTables.push_back(new AttenuationTable(volume->GetMaterial()));
     }
     //windowKaptonVolume = G4LogicalVolumeStore::GetInstance()->GetVolume("WindowKaptonLogical");
     //windowCopperVolume = G4LogicalVolumeStore::GetInstance()->GetVolume("WindowCopperLogical");
@@ -89,13 +103,46 @@ void SteppingAction::UserSteppingAction(const G4Step* step) {
   //cout << volumesBeforeDrift.size() << endl;
   
   G4LogicalVolume* volume = step->GetPreStepPoint()->GetTouchableHandle()->GetVolume()->GetLogicalVolume();
+  INSTRUMENT(instrumentation.CountStep(volume, track->GetParticleDefinition()));
+
+#ifdef GEMXRAY_INSTRUMENT
+  // time per region, a clock read per step, so only in instrumented builds;
+  // the first step of an event also contains the event bookkeeping
+  auto stepTime = std::chrono::steady_clock::now();
+  if (!(trackID==1 && track->GetCurrentStepNumber()==1)) {
+    G4Region *region = volume->GetRegion();
+    if (region!=fLastRegion) {
+      fRegionTime = eventAction->GetRunAction()->GetRegionTimer(region->GetName());
+      fLastRegion = region;
+    }
+    *fRegionTime += std::chrono::duration<double>(stepTime-fLastStepTime).count();
+  }
+  fLastStepTime = stepTime;
+#endif
   G4String particleName = track->GetParticleDefinition()->GetParticleName();
   G4LogicalVolume *nextVolume = track->GetNextVolume()->GetLogicalVolume();
 
+  // derivative of the log-likelihood of the photon history with respect to
+  // the density of the layer: interactions minus mu times path length
+  if (fAttenuationTables.size()>0 and particleName==G4String("gamma")) {
+    for (size_t i=0; i<volumesBeforeDrift.size(); i++) {
+      if (volume!=volumesBeforeDrift[i]) continue;
+      G4double score = -fAttenuationTables[i]->GetAttenuation(step->GetPreStepPoint()->GetKineticEnergy())*step->GetStepLength();
+      const G4VProcess *process = step->GetPostStepPoint()->GetProcessDefinedStep();
+      if (process) {
+        G4String processName = process->GetProcessName();
+        if (processName=="phot" || processName=="compt" || processName=="Rayl") score += 1.;
+      }
+      this->eventAction->AddSensitivityScore(volumeBranchNames[i], score, fPrimary);
+    }
+  }
+
+  // crossing photons are recorded with the weight they had before the
+  // boundary, the track weight is already that after a split or roulette
   if (step->IsLastStepInVolume() and particleName==G4String("gamma")) {
     for (int i=0; i<volumesBeforeDrift.size()-1; i++) {
       if (volume==volumesBeforeDrift[i])
-        this->eventAction->AddHit(volumeBranchNames[i], step->GetPreStepPoint()->GetTotalEnergy()*1.e3);
+        this->eventAction->AddHit(volumeBranchNames[i], step->GetPreStepPoint()->GetTotalEnergy()*1.e3, step->GetPreStepPoint()->GetWeight(), fPrimary);
     }
     //if (volume==windowKaptonVolume) this->eventAction->AddHit("window", step->GetPreStepPoint()->GetTotalEnergy()*1.e3);
     //else if (volume==driftFr4Volume) this->eventAction->AddHit("driftFr4", step->GetPreStepPoint()->GetTotalEnergy()*1.e3);
@@ -103,18 +150,20 @@ void SteppingAction::UserSteppingAction(const G4Step* step) {
     //if (volume==driftCopperVolume) {
     if (volume==volumesBeforeDrift[volumesBeforeDrift.size()-1]) { // last volume before gas is always copper drit
       //cout << track->GetCreatorProcess()->GetProcessName() << endl;
-      this->eventAction->AddHit(volumeBranchNames[volumeBranchNames.size()-1], step->GetPreStepPoint()->GetTotalEnergy()*1.e3);
+      this->eventAction->AddHit(volumeBranchNames[volumeBranchNames.size()-1], step->GetPreStepPoint()->GetTotalEnergy()*1.e3, step->GetPreStepPoint()->GetWeight(), fPrimary);
       this->eventAction->AddPhoton(
         step->GetPostStepPoint()->GetTotalEnergy()*1.e3,
         step->GetPostStepPoint()->GetPosition(),
-        step->GetPostStepPoint()->GetMomentumDirection()
+        step->GetPostStepPoint()->GetMomentumDirection(),
+        step->GetPreStepPoint()->GetWeight(),
+        fPrimary
       );
       //cout << step->GetPreStepPoint()->GetPosition() << " ";
       //cout << step->GetPostStepPoint()->GetPosition() << endl;
     }
   } else if (step->IsFirstStepInVolume() and volume==driftGapVolume) {
     if (particleName!=G4String("gamma") and particleName!=G4String("e-")) {
-      cout << particleName << endl;
+      LOG_WARNING("Unexpected " << particleName << " entering the drift gap");
     } else if (particleName==G4String("gamma")) {
       //if (track->GetCreatorProcess()) cout << track->GetCreatorProcess()->GetProcessName() << endl;
     } else if (particleName==G4String("e-")) {
@@ -122,7 +171,9 @@ void SteppingAction::UserSteppingAction(const G4Step* step) {
       this->eventAction->AddElectron(
         step->GetPostStepPoint()->GetKineticEnergy()*1.e3,
         step->GetPostStepPoint()->GetPosition(),
-        step->GetPostStepPoint()->GetMomentumDirection()
+        step->GetPostStepPoint()->GetMomentumDirection(),
+        track->GetWeight(),
+        fPrimary
       );
       //cout << step->GetPreStepPoint()->GetPosition() << " ";
       //cout << step->GetPostStepPoint()->GetPosition() << endl;
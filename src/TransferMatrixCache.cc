@@ -0,0 +1,177 @@
+/// \file TransferMatrixCache.cc
+/// \brief Implementation of the TransferMatrixCache class
+
+#include "TransferMatrixCache.hh"
+#include "RunAction.hh"
+#include "RunConfiguration.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "Fnv1a.hh"
+
+#include "G4RunManager.hh"
+
+#include <sys/stat.h>
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+namespace {
+  LayerDescription SlabOf(LayerDescription layer) {
+    if (layer.material==G4String("vacuum")) layer.material = "air";
+    return layer;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+TransferMatrixCache::TransferMatrixCache(G4String directory, G4String emOption, G4double defaultCut) {
+  fDirectory = directory;
+  fEmOption = emOption;
+  fDefaultCut = defaultCut;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String TransferMatrixCache::GetPath(const LayerDescription &layer) const {
+  LayerDescription slab = SlabOf(layer);
+  // the cut the slab is simulated with, a layer without one takes --cut
+  G4double cut = slab.cut>0 ? slab.cut : fDefaultCut;
+  std::ostringstream description;
+  description << slab.material << " " << slab.thickness << " " << cut << " " << slab.fluo << " "
+              << slab.auger << " " << slab.pixe << " " << slab.msc << " " << fEmOption << " "
+              << fNBins << " " << fMinEnergy << " " << fMaxEnergy;
+  std::ostringstream path;
+  path << fDirectory << "/" << slab.material << "_" << slab.thickness << "mm_" << Fnv1aHex(description.str()) << ".txt";
+  return path.str();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool TransferMatrixCache::Has(const LayerDescription &layer) const {
+  struct stat matrixStat;
+  return stat(GetPath(layer).c_str(), &matrixStat)==0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool TransferMatrixCache::Has(const LayerStack &layers) const {
+  LayerDescription slab;
+  return GetSlab(layers, slab) && Has(slab);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool TransferMatrixCache::GetSlab(const LayerStack &layers, LayerDescription &slab) const {
+  G4int nSlabs = 0;
+  for (auto layer:layers) {
+    if (layer.material==G4String("vacuum")) continue;
+    slab = layer;
+    nSlabs++;
+  }
+  return nSlabs==1;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void TransferMatrixCache::Build(const LayerStack &layers, G4int eventsPerEnergy) {
+  LayerDescription slab;
+  if (!GetSlab(layers, slab)) {
+    G4ExceptionDescription msg;
+    msg << "Transfer matrices are built from a stack with exactly one non-vacuum layer";
+    G4Exception("TransferMatrixCache::Build()", "MyCode0040", FatalException, msg);
+    return;
+  }
+  G4String branchName = slab.material+"1";
+
+  RunConfiguration *configuration = RunConfiguration::Instance();
+  configuration->SetSource("mono");
+  G4RunManager *runManager = G4RunManager::GetRunManager();
+  const RunAction *runAction = (const RunAction *)runManager->GetUserRunAction();
+
+  ResponseMatrix matrix(fNBins, fMinEnergy, fMaxEnergy, fNBins, fMinEnergy, fMaxEnergy);
+  // whole events of several photons each when so configured
+  G4int photonsPerEvent = configuration->GetPhotonsPerEvent();
+  G4int nEvents = (eventsPerEnergy+photonsPerEvent-1)/photonsPerEvent;
+  auto start = std::chrono::steady_clock::now();
+  for (G4int in=0; in<fNBins; in++) {
+    configuration->SetMonoEnergy(matrix.GetInCenter(in));
+    runManager->BeamOn(nEvents);
+
+    TH1D *histogram = runAction->GetHistograms().at(branchName);
+    std::vector<double> column(fNBins);
+    for (G4int out=0; out<fNBins; out++) column[out] = histogram->GetBinContent(out+1)/(nEvents*photonsPerEvent);
+    matrix.SetColumn(in, column);
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now()-start;
+
+  std::ostringstream description;
+  description << "# " << slab.material << " " << slab.thickness << " mm, " << fEmOption << ", "
+              << eventsPerEnergy << " photons per energy";
+  matrix.SetDescription(description.str());
+  mkdir(fDirectory.c_str(), 0755);
+  G4String path = GetPath(slab);
+  if (!matrix.Write(path)) {
+    G4ExceptionDescription msg;
+    msg << "Cannot write transfer matrix " << path;
+    G4Exception("TransferMatrixCache::Build()", "MyCode0040", FatalException, msg);
+  }
+  G4cout << "Transfer matrix written to " << path << " in " << elapsed.count() << " s" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void TransferMatrixCache::Compose(const LayerStack &layers, G4String source, G4String spectrumPath, G4String outPath) const {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<G4double> energies, probabilities;
+  PrimaryGeneratorAction::GetSourceSpectrum(source, spectrumPath, energies, probabilities);
+
+  ResponseMatrix stackMatrix(fNBins, fMinEnergy, fMaxEnergy, fNBins, fMinEnergy, fMaxEnergy);
+  for (G4int bin=0; bin<fNBins; bin++) stackMatrix(bin, bin) = 1.;
+  std::vector<double> spectrum = stackMatrix.Bin(energies, probabilities);
+
+  // per source photon, branch names as in the simulation output
+  std::vector<std::pair<G4String, std::vector<double>>> spectra;
+  spectra.push_back(std::make_pair(G4String("primary"), spectrum));
+  G4int materialIndex = 0;
+  for (auto layer:layers) {
+    ResponseMatrix slabMatrix;
+    if (!slabMatrix.Read(GetPath(layer))) {
+      G4ExceptionDescription msg;
+      msg << "No transfer matrix for " << layer.material << " " << layer.thickness << " mm in " << fDirectory
+          << ", build it with --transfer-build on a stack of this layer only";
+      G4Exception("TransferMatrixCache::Compose()", "MyCode0040", FatalException, msg);
+      return;
+    }
+    stackMatrix = stackMatrix.Then(slabMatrix);
+    spectrum = slabMatrix.Apply(spectrum);
+    if (layer.material==G4String("vacuum")) continue;
+    materialIndex++;
+    spectra.push_back(std::make_pair(layer.material+std::to_string(materialIndex), spectrum));
+  }
+  spectra.push_back(std::make_pair(G4String("gap_entry"), spectrum));
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now()-start;
+
+  std::ofstream outFile(outPath);
+  outFile << std::setprecision(10);
+  outFile << "{\n  \"seconds\": " << elapsed.count() << ",\n  \"histograms\": {";
+  G4String separator = "";
+  for (auto spectrumPair:spectra) {
+    outFile << separator << "\n    \"" << spectrumPair.first << "\": {";
+    outFile << "\"min\": " << fMinEnergy << ", \"max\": " << fMaxEnergy << ", \"contents\": [";
+    for (size_t bin=0; bin<spectrumPair.second.size(); bin++)
+      outFile << (bin>0 ? ", " : "") << spectrumPair.second[bin];
+    outFile << "]}";
+    separator = ",";
+  }
+  outFile << "\n  }\n}\n";
+  G4cout << "Composed spectra written to " << outPath << " in " << elapsed.count()*1e3 << " ms" << G4endl;
+
+  // the whole stack, for reuse on other sources
+  stackMatrix.SetDescription("# stack of "+std::to_string(layers.size())+" layers, "+fEmOption);
+  stackMatrix.Write(outPath+".matrix");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
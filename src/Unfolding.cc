@@ -0,0 +1,141 @@
+/// \file Unfolding.cc
+/// \brief Implementation of the Unfolding class
+
+#include "Unfolding.hh"
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+Unfolding::Unfolding(const ResponseMatrix &matrix, int nThreads):fMatrix(matrix) {
+  fNThreads = std::max(1, nThreads);
+  fEfficiency = Transposed(std::vector<double>(fMatrix.GetNOut(), 1.));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+template <typename Function> void Unfolding::ParallelFor(int n, Function function) const {
+  // function(begin, end) on contiguous ranges, the calling thread takes the first
+  int nThreads = std::min(fNThreads, std::max(1, n/256));
+  std::vector<std::thread> threads;
+  for (int thread=1; thread<nThreads; thread++)
+    threads.emplace_back(function, (long)n*thread/nThreads, (long)n*(thread+1)/nThreads);
+  function(0L, (long)n/nThreads);
+  for (std::thread &thread : threads) thread.join();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<double> Unfolding::Forward(const std::vector<double> &input) const {
+  std::vector<double> output(fMatrix.GetNOut(), 0.);
+  int nIn = fMatrix.GetNIn();
+  ParallelFor(fMatrix.GetNOut(), [&](long begin, long end) {
+    double *__restrict__ outputData = output.data();
+    for (int in=0; in<nIn; in++) {
+      const double scale = input[in];
+      if (scale==0.) continue;
+      const double *__restrict__ column = fMatrix.GetColumn(in);
+      for (long out=begin; out<end; out++) outputData[out] += scale*column[out];
+    }
+  });
+  return output;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<double> Unfolding::Transposed(const std::vector<double> &output) const {
+  std::vector<double> input(fMatrix.GetNIn(), 0.);
+  long nOut = fMatrix.GetNOut();
+  ParallelFor(fMatrix.GetNIn(), [&](long begin, long end) {
+    const double *__restrict__ outputData = output.data();
+    for (long in=begin; in<end; in++) {
+      const double *__restrict__ column = fMatrix.GetColumn(in);
+      // independent partial sums, so the dot product vectorises without -ffast-math
+      double sum[4] = {0., 0., 0., 0.};
+      long out = 0;
+      for (; out+4<=nOut; out+=4)
+        for (int lane=0; lane<4; lane++) sum[lane] += column[out+lane]*outputData[out+lane];
+      for (; out<nOut; out++) sum[0] += column[out]*outputData[out];
+      input[in] = (sum[0]+sum[1])+(sum[2]+sum[3]);
+    }
+  });
+  return input;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<double> Unfolding::Mlem(const std::vector<double> &measured, int iterations) const {
+  int nIn = fMatrix.GetNIn(), nOut = fMatrix.GetNOut();
+  double total = std::accumulate(measured.begin(), measured.end(), 0.);
+  double efficiency = std::accumulate(fEfficiency.begin(), fEfficiency.end(), 0.)/nIn;
+  std::vector<double> estimate(nIn, efficiency>0. ? total/efficiency/nIn : 0.);
+
+  std::vector<double> ratio(nOut);
+  for (int iteration=0; iteration<iterations; iteration++) {
+    std::vector<double> folded = Forward(estimate);
+    for (int out=0; out<nOut; out++) ratio[out] = folded[out]>0. ? measured[out]/folded[out] : 0.;
+    std::vector<double> correction = Transposed(ratio);
+    // input bins the detector never sees keep no content
+    for (int in=0; in<nIn; in++) estimate[in] = fEfficiency[in]>0. ? estimate[in]*correction[in]/fEfficiency[in] : 0.;
+  }
+  return estimate;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<double> Unfolding::Tikhonov(const std::vector<double> &measured, double regularisation, int iterations) const {
+  int nIn = fMatrix.GetNIn(), nOut = fMatrix.GetNOut();
+  std::vector<double> weight(nOut);
+  for (int out=0; out<nOut; out++) weight[out] = 1./std::max(measured[out], 1.);
+
+  // normal equations (R^T W R + a D^T D) x = R^T W y, D the second difference
+  auto normal = [&](const std::vector<double> &x) {
+    std::vector<double> folded = Forward(x);
+    for (int out=0; out<nOut; out++) folded[out] *= weight[out];
+    std::vector<double> result = Transposed(folded);
+    std::vector<double> curvature(nIn, 0.);
+    for (int in=1; in+1<nIn; in++) curvature[in] = x[in-1]-2.*x[in]+x[in+1];
+    for (int in=1; in+1<nIn; in++) {
+      result[in-1] += regularisation*curvature[in];
+      result[in] -= 2.*regularisation*curvature[in];
+      result[in+1] += regularisation*curvature[in];
+    }
+    return result;
+  };
+  auto dot = [](const std::vector<double> &a, const std::vector<double> &b) {
+    return std::inner_product(a.begin(), a.end(), b.begin(), 0.);
+  };
+
+  std::vector<double> weighted(nOut);
+  for (int out=0; out<nOut; out++) weighted[out] = weight[out]*measured[out];
+  std::vector<double> x(nIn, 0.), residual = Transposed(weighted), direction = residual;
+  double residualNorm = dot(residual, residual), targetNorm = residualNorm*1e-20;
+  for (int iteration=0; iteration<iterations && residualNorm>targetNorm; iteration++) {
+    std::vector<double> product = normal(direction);
+    double step = residualNorm/dot(direction, product);
+    for (int in=0; in<nIn; in++) {
+      x[in] += step*direction[in];
+      residual[in] -= step*product[in];
+    }
+    double newNorm = dot(residual, residual);
+    for (int in=0; in<nIn; in++) direction[in] = residual[in]+newNorm/residualNorm*direction[in];
+    residualNorm = newNorm;
+  }
+  // a spectrum has no negative content
+  for (double &content : x) content = std::max(content, 0.);
+  return x;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+double Unfolding::Chi2(const std::vector<double> &measured, const std::vector<double> &estimate) const {
+  std::vector<double> folded = Forward(estimate);
+  double chi2 = 0.;
+  for (size_t out=0; out<folded.size(); out++)
+    chi2 += (folded[out]-measured[out])*(folded[out]-measured[out])/std::max(measured[out], 1.);
+  return chi2;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,46 @@
+#!/usr/bin/python3
+
+import os, sys
+import argparse
+import subprocess
+import tempfile
+
+def read_stack(path):
+    ''' Layers of a stack file as (material, thickness, settings) '''
+    layers = list()
+    with open(path) as stackFile:
+        for line in stackFile:
+            fields = line.split('#')[0].split()
+            if len(fields)<2: continue
+            layers.append((fields[0], fields[1], fields[2:]))
+    return layers
+
+def main():
+    ap = argparse.ArgumentParser(add_help=True, description='Build the missing slab transfer matrices of a stack and compose it')
+    ap.add_argument('-s', '--stack', required=True, help='layer file')
+    ap.add_argument('-c', '--cache', default='transfer-matrices')
+    ap.add_argument('-o', '--output', default='transfer-spectra.json')
+    ap.add_argument('--executable', default='./gem-xray')
+    ap.add_argument('--em-option', default='livermore')
+    ap.add_argument('--events', type=int, default=10000, help='photons per incident energy')
+    ap.add_argument('--spectrum', default='xray')
+    ap.add_argument('--spectrum-file', default='xray-spectrum.csv')
+    ap.add_argument('-v', '--verbose', action='store_true')
+    options = ap.parse_args(sys.argv[1:])
+
+    with tempfile.TemporaryDirectory() as workDir:
+        slabPath = os.path.join(workDir, 'slab.txt')
+        for material, thickness, settings in read_stack(options.stack):
+            if material=='vacuum': material = 'air' # the envelope air
+            with open(slabPath, 'w') as slabFile: slabFile.write(' '.join([material, thickness]+settings)+'\n')
+            print('Transfer matrix of %s %s mm...'%(material, thickness))
+            command = [options.executable, '--stack', slabPath, '--em-option', options.em_option,
+                '--transfer-build', options.cache, '--transfer-events', str(options.events)]
+            subprocess.run(command, check=True, stdout=None if options.verbose else subprocess.DEVNULL)
+
+    command = [options.executable, '--stack', options.stack, '--em-option', options.em_option,
+        '--spectrum', options.spectrum, '--spectrum-file', options.spectrum_file,
+        '--transfer-compose', options.cache, '--transfer-out', options.output]
+    subprocess.run(command, check=True)
+
+if __name__=='__main__': main()